@@ -366,6 +366,16 @@ void freeAsgn(astNode *node){
 	return;
 }
 
+/* record the source position of a node; values too large for the bitfields are dropped */
+astNode* setLoc(astNode *node, int line, int col){
+	if (node == NULL) return node;
+
+	node->loc.line = (line > 0 && line < (1 << 20)) ? line : 0;
+	node->loc.col = (col > 0 && col < (1 << 12)) ? col : 0;
+
+	return(node);
+}
+
 /* free function for releasing all the memory assigned to a node based
 on the type. This function is called by other free* functions when
 the type of a child node is not obvious from the context */
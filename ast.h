@@ -143,8 +143,16 @@ struct ast_Stmt{
 		};
 	};
 
+/* Source position of a node. Packed into the padding after the type tag so
+   nodes do not grow; 0 means unknown. */
+typedef struct {
+		unsigned line : 20; // 1-based line number
+		unsigned col  : 12; // 1-based column number
+	} srcLoc;
+
 struct ast_Node{
 		node_type type;
+		srcLoc loc;
 		union {
 		  astProg   prog;
 		  astFunc   func;
@@ -188,6 +196,9 @@ astNode* createIf(astNode* cond, astNode* if_body, astNode* else_body=NULL);
 astNode* createDecl(const char* decl);
 astNode* createAsgn(astNode* lhs, astNode* rhs);
 
+/* Records the source position on node and returns node, so it can wrap a create* call. */
+astNode* setLoc(astNode* node, int line, int col);
+
 /* 
 Declarations for all free* functions. All these functions take a astNode* as parameter
 as free the memory allocated by corresponding create functions.
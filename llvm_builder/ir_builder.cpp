@@ -12,7 +12,15 @@
 #include <unordered_set>
 #include <vector>
 
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+
 #include <llvm-c/Core.h>
+#include <llvm-c/DebugInfo.h>
+#include <llvm-c/Target.h>
+#include <llvm-c/TargetMachine.h>
 
 /* Per-function map: unique variable name -> alloca instruction. */
 static std::unordered_map<std::string, LLVMValueRef> var_map;
@@ -27,6 +35,11 @@ static LLVMBasicBlockRef retBB = nullptr;
 static LLVMValueRef printFn = nullptr;
 static LLVMValueRef readFn  = nullptr;
 
+/* Debug info builder and current function scope; null when not emitting debug info. */
+static LLVMDIBuilderRef diBuilder = nullptr;
+static LLVMMetadataRef diFile = nullptr;
+static LLVMMetadataRef diScope = nullptr;
+
 /* Return the LLVM i32 type. */
 static LLVMTypeRef i32Ty() {
     return LLVMInt32Type();
@@ -51,8 +64,19 @@ static void brIfNoTerminator(LLVMBuilderRef builder, LLVMBasicBlockRef fromBB, L
     }
 }
 
+/* Variable names in first-declaration order, without duplicates. Allocas are
+ * emitted in this order so identical input always yields identical IR. */
+struct DeclNames {
+    std::vector<std::string> order;
+    std::unordered_set<std::string> seen;
+
+    void add(const std::string &name) {
+        if (seen.insert(name).second) order.push_back(name);
+    }
+};
+
 /* Collect all declared variable names in a statement subtree. */
-static void collectDeclNames(astNode *stmtNode, std::unordered_set<std::string> &names);
+static void collectDeclNames(astNode *stmtNode, DeclNames &names);
 
 /* Generate IR for an expression and return an LLVMValueRef. */
 static LLVMValueRef genIRExpr(astNode *expr, LLVMBuilderRef builder);
@@ -63,6 +87,114 @@ static LLVMBasicBlockRef genIRStmt(astNode *stmt, LLVMBuilderRef builder, LLVMBa
 /* Delete basic blocks that have no path from entryBB (BFS reachability). */
 static void removeUnreachableBlocks(LLVMValueRef fn, LLVMBasicBlockRef entryBB);
 
+/* CPU name and feature string the generated function is tuned for. */
+static std::string targetCPU;
+static std::string targetFeatures;
+
+/* Set the host triple and data layout on M and pick the CPU to tune for. */
+static void setModuleTarget(LLVMModuleRef M, const char *march) {
+    char *triple = LLVMGetDefaultTargetTriple();
+    LLVMSetTarget(M, triple);
+
+    // native (the default) takes both the CPU and its features from the host
+    if (march == nullptr || std::strcmp(march, "native") == 0) {
+        char *cpu = LLVMGetHostCPUName();
+        char *features = LLVMGetHostCPUFeatures();
+        targetCPU = cpu;
+        targetFeatures = features;
+        LLVMDisposeMessage(cpu);
+        LLVMDisposeMessage(features);
+    } else {
+        targetCPU = march;
+        targetFeatures.clear();
+    }
+
+    // The data layout comes from a target machine for the chosen CPU
+    LLVMInitializeNativeTarget();
+    LLVMTargetRef target = nullptr;
+    char *error = nullptr;
+    if (LLVMGetTargetFromTriple(triple, &target, &error) != 0) {
+        std::fprintf(stderr, "Warning: no data layout for %s: %s\n", triple, error);
+        LLVMDisposeMessage(error);
+        LLVMDisposeMessage(triple);
+        return;
+    }
+
+    LLVMTargetMachineRef tm = LLVMCreateTargetMachine(target, triple, targetCPU.c_str(), targetFeatures.c_str(),
+                                                      LLVMCodeGenLevelDefault, LLVMRelocDefault, LLVMCodeModelDefault);
+    LLVMTargetDataRef layout = LLVMCreateTargetDataLayout(tm);
+    LLVMSetModuleDataLayout(M, layout);
+
+    LLVMDisposeTargetData(layout);
+    LLVMDisposeTargetMachine(tm);
+    LLVMDisposeMessage(triple);
+}
+
+/* Create the compile unit for the source file and the module flags debug info needs. */
+static void beginDebugInfo(LLVMModuleRef M, const char *sourcePath) {
+    diBuilder = LLVMCreateDIBuilder(M);
+
+    // Split into directory and file name; relative paths are relative to the cwd
+    std::string path(sourcePath);
+    std::string dir, name;
+    size_t slash = path.rfind('/');
+    if (!path.empty() && path[0] == '/') {
+        dir = path.substr(0, slash);
+        name = path.substr(slash + 1);
+    } else {
+        char cwd[4096];
+        dir = getcwd(cwd, sizeof(cwd)) ? cwd : ".";
+        name = path;
+    }
+
+    diFile = LLVMDIBuilderCreateFile(diBuilder, name.c_str(), name.size(), dir.c_str(), dir.size());
+
+    const char *producer = "miniC compiler";
+    LLVMDIBuilderCreateCompileUnit(diBuilder, LLVMDWARFSourceLanguageC, diFile, producer, std::strlen(producer),
+                                   /*isOptimized*/ 0, "", 0, /*RuntimeVer*/ 0, "", 0,
+                                   LLVMDWARFEmissionLineTablesOnly, /*DWOId*/ 0, /*SplitDebugInlining*/ 0,
+                                   /*DebugInfoForProfiling*/ 0, "", 0, "", 0);
+
+    LLVMTypeRef i32 = i32Ty();
+    const char *dwarfKey = "Dwarf Version";
+    const char *versionKey = "Debug Info Version";
+    LLVMAddModuleFlag(M, LLVMModuleFlagBehaviorWarning, dwarfKey, std::strlen(dwarfKey),
+                      LLVMValueAsMetadata(LLVMConstInt(i32, 4, 0)));
+    LLVMAddModuleFlag(M, LLVMModuleFlagBehaviorWarning, versionKey, std::strlen(versionKey),
+                      LLVMValueAsMetadata(LLVMConstInt(i32, LLVMDebugMetadataVersion(), 0)));
+}
+
+/* Attach a subprogram for fn starting at the given source line. */
+static void beginDebugFunction(LLVMValueRef fn, const char *name, unsigned line) {
+    if (!diBuilder) return;
+
+    LLVMMetadataRef fnTy = LLVMDIBuilderCreateSubroutineType(diBuilder, diFile, nullptr, 0, LLVMDIFlagZero);
+    diScope = LLVMDIBuilderCreateFunction(diBuilder, diFile, name, std::strlen(name), name, std::strlen(name),
+                                          diFile, line, fnTy, /*IsLocalToUnit*/ 0, /*IsDefinition*/ 1,
+                                          line, LLVMDIFlagPrototyped, /*IsOptimized*/ 0);
+    LLVMSetSubprogram(fn, diScope);
+}
+
+/* Give instructions built next the source position of node (if it has one). */
+static void setDebugLoc(LLVMBuilderRef builder, astNode *node) {
+    if (!diBuilder || !node || node->loc.line == 0) return;
+
+    LLVMMetadataRef loc = LLVMDIBuilderCreateDebugLocation(LLVMGetGlobalContext(), node->loc.line, node->loc.col,
+                                                           diScope, nullptr);
+    LLVMSetCurrentDebugLocation2(builder, loc);
+}
+
+/* Finalize and release the debug info builder. */
+static void endDebugInfo() {
+    if (!diBuilder) return;
+
+    LLVMDIBuilderFinalize(diBuilder);
+    LLVMDisposeDIBuilder(diBuilder);
+    diBuilder = nullptr;
+    diFile = nullptr;
+    diScope = nullptr;
+}
+
 /* Declare extern functions print and read. */
 static void declareExterns(LLVMModuleRef M) {
     // declare void @print(i32)
@@ -76,7 +208,7 @@ static void declareExterns(LLVMModuleRef M) {
 }
 
 /* Collect declaration names inside a block statement list. */
-static void collectDeclNamesInBlock(astNode *blockStmtNode, std::unordered_set<std::string> &names) {
+static void collectDeclNamesInBlock(astNode *blockStmtNode, DeclNames &names) {
     if (!blockStmtNode) return;
 
     if (blockStmtNode->type != ast_stmt || blockStmtNode->stmt.type != ast_block) {
@@ -93,7 +225,7 @@ static void collectDeclNamesInBlock(astNode *blockStmtNode, std::unordered_set<s
 }
 
 /* Collect all decl names in any statement subtree. */
-static void collectDeclNames(astNode *stmtNode, std::unordered_set<std::string> &names) {
+static void collectDeclNames(astNode *stmtNode, DeclNames &names) {
     if (!stmtNode) return;
 
     // Expression-statements show up as raw expression nodes
@@ -105,7 +237,7 @@ static void collectDeclNames(astNode *stmtNode, std::unordered_set<std::string>
     switch (stmtNode->stmt.type) {
         case ast_decl:
             if (stmtNode->stmt.decl.name) {
-                names.insert(std::string(stmtNode->stmt.decl.name));
+                names.add(std::string(stmtNode->stmt.decl.name));
             }
             break;
 
@@ -157,18 +289,21 @@ static LLVMValueRef genIRExpr(astNode *expr, LLVMBuilderRef builder) {
         case ast_var: {
             std::string name = expr->var.name ? std::string(expr->var.name) : std::string("");
             LLVMValueRef allocaRef = var_map[name];
+            setDebugLoc(builder, expr);
             return LLVMBuildLoad2(builder, i32Ty(), allocaRef, "loadtmp");
         }
 
         case ast_uexpr: {
             // Unary minus: 0 - expr
             LLVMValueRef val = genIRExpr(expr->uexpr.expr, builder);
+            setDebugLoc(builder, expr);
             return LLVMBuildSub(builder, constI32(0), val, "negtmp");
         }
 
         case ast_bexpr: {
             LLVMValueRef lhs = genIRExpr(expr->bexpr.lhs, builder);
             LLVMValueRef rhs = genIRExpr(expr->bexpr.rhs, builder);
+            setDebugLoc(builder, expr);
 
             switch (expr->bexpr.op) {
                 case add:    return LLVMBuildAdd(builder, lhs, rhs, "addtmp");
@@ -183,6 +318,7 @@ static LLVMValueRef genIRExpr(astNode *expr, LLVMBuilderRef builder) {
             LLVMValueRef lhs = genIRExpr(expr->rexpr.lhs, builder);
             LLVMValueRef rhs = genIRExpr(expr->rexpr.rhs, builder);
             LLVMIntPredicate pred = mapRelOp(expr->rexpr.op);
+            setDebugLoc(builder, expr);
             return LLVMBuildICmp(builder, pred, lhs, rhs, "cmptmp");
         }
 
@@ -190,6 +326,7 @@ static LLVMValueRef genIRExpr(astNode *expr, LLVMBuilderRef builder) {
             // read() appears in expressions as a call node (created by createCall("read", NULL))
             if (expr->stmt.type == ast_call && expr->stmt.call.name && std::string(expr->stmt.call.name) == "read") {
                 LLVMTypeRef readTy = LLVMFunctionType(i32Ty(), nullptr, 0, 0);
+                setDebugLoc(builder, expr);
                 return LLVMBuildCall2(builder, readTy, readFn, nullptr, 0, "readtmp");
             }
 
@@ -228,6 +365,7 @@ static LLVMBasicBlockRef genIRStmt(astNode *stmt, LLVMBuilderRef builder, LLVMBa
             std::string lhsName = lhsNode->var.name ? std::string(lhsNode->var.name) : std::string("");
             LLVMValueRef lhsAlloca = var_map[lhsName];
 
+            setDebugLoc(builder, stmt);
             LLVMBuildStore(builder, rhsVal, lhsAlloca);
             return startBB;
         }
@@ -244,6 +382,7 @@ static LLVMBasicBlockRef genIRStmt(astNode *stmt, LLVMBuilderRef builder, LLVMBa
             LLVMValueRef args[1] = { argVal };
             LLVMTypeRef printArgs[1] = { i32Ty() };
             LLVMTypeRef printTy = LLVMFunctionType(voidTy(), printArgs, 1, 0);
+            setDebugLoc(builder, stmt);
             LLVMBuildCall2(builder, printTy, printFn, args, 1, "");
 
             return startBB;
@@ -257,11 +396,13 @@ static LLVMBasicBlockRef genIRStmt(astNode *stmt, LLVMBuilderRef builder, LLVMBa
             LLVMBasicBlockRef trueBB  = LLVMAppendBasicBlock(fn, "while.body");
             LLVMBasicBlockRef falseBB = LLVMAppendBasicBlock(fn, "while.end");
 
+            setDebugLoc(builder, stmt);
             LLVMBuildBr(builder, condBB);
 
             // Condition block
             LLVMPositionBuilderAtEnd(builder, condBB);
             LLVMValueRef condVal = genIRExpr(stmt->stmt.whilen.cond, builder);
+            setDebugLoc(builder, stmt);
             LLVMBuildCondBr(builder, condVal, trueBB, falseBB);
 
             // Body block
@@ -279,6 +420,7 @@ static LLVMBasicBlockRef genIRStmt(astNode *stmt, LLVMBuilderRef builder, LLVMBa
             LLVMBasicBlockRef falseBB = LLVMAppendBasicBlock(fn, "if.else_or_end");
 
             LLVMValueRef condVal = genIRExpr(stmt->stmt.ifn.cond, builder);
+            setDebugLoc(builder, stmt);
             LLVMBuildCondBr(builder, condVal, trueBB, falseBB);
 
             if (stmt->stmt.ifn.else_body == nullptr) {
@@ -306,6 +448,7 @@ static LLVMBasicBlockRef genIRStmt(astNode *stmt, LLVMBuilderRef builder, LLVMBa
             LLVMPositionBuilderAtEnd(builder, startBB);
 
             LLVMValueRef retVal = genIRExpr(stmt->stmt.ret.expr, builder);
+            setDebugLoc(builder, stmt);
             LLVMBuildStore(builder, retVal, ret_ref);
             LLVMBuildBr(builder, retBB);
 
@@ -380,18 +523,24 @@ static void removeUnreachableBlocks(LLVMValueRef fn, LLVMBasicBlockRef entryBB)
 }
 
 /* Build LLVM module for the whole program AST. */
-LLVMModuleRef BuildLLVMModule(astNode *root) {
+LLVMModuleRef BuildLLVMModule(astNode *root, const char *march, const char *debugFile) {
     if (!root) return nullptr;
 
     // Create module and set the target architecture
     LLVMModuleRef M = LLVMModuleCreateWithName("minic_module");
-    LLVMSetTarget(M, "x86_64-pc-linux-gnu");
+    setModuleTarget(M, march);
+
+    // Line tables for the source file, if requested
+    if (debugFile) {
+        beginDebugInfo(M, debugFile);
+    }
 
     // Add extern declarations for print and read
     declareExterns(M);
 
     // Program contains one function node at prog.func
     if (root->type != ast_prog || root->prog.func == nullptr || root->prog.func->type != ast_func) {
+        endDebugInfo();
         return M;
     }
 
@@ -402,19 +551,25 @@ LLVMModuleRef BuildLLVMModule(astNode *root) {
     LLVMTypeRef paramTypes[1] = { i32Ty() };
     LLVMTypeRef fnTy = LLVMFunctionType(i32Ty(), (paramCount ? paramTypes : nullptr), paramCount, 0);
 
-    // Add the function to the module
+    // Add the function to the module, tuned for the selected CPU
     LLVMValueRef fn = LLVMAddFunction(M, fnNode->func.name, fnTy);
+    LLVMAddTargetDependentFunctionAttr(fn, "target-cpu", targetCPU.c_str());
+    if (!targetFeatures.empty()) {
+        LLVMAddTargetDependentFunctionAttr(fn, "target-features", targetFeatures.c_str());
+    }
 
-    // Create builder and entry block
+    // Create builder and entry block; prologue and return code get the function's line
     LLVMBuilderRef builder = LLVMCreateBuilder();
     LLVMBasicBlockRef entryBB = LLVMAppendBasicBlock(fn, "entry");
     LLVMPositionBuilderAtEnd(builder, entryBB);
+    beginDebugFunction(fn, fnNode->func.name, fnNode->loc.line);
+    setDebugLoc(builder, fnNode);
 
-    // Create a set of names for parameter and local variables
-    std::unordered_set<std::string> names;
+    // Collect names for parameter and local variables in source order
+    DeclNames names;
 
     if (fnNode->func.param && fnNode->func.param->type == ast_var && fnNode->func.param->var.name) {
-        names.insert(std::string(fnNode->func.param->var.name));
+        names.add(std::string(fnNode->func.param->var.name));
     }
 
     // Collect declared locals from the function body
@@ -424,7 +579,7 @@ LLVMModuleRef BuildLLVMModule(astNode *root) {
     var_map.clear();
 
     // Create allocas for all parameters and locals in entry block
-    for (const std::string &name : names) {
+    for (const std::string &name : names.order) {
         LLVMValueRef a = LLVMBuildAlloca(builder, i32Ty(), name.c_str());
         LLVMSetAlignment(a, 4);
         var_map[name] = a;
@@ -447,6 +602,7 @@ LLVMModuleRef BuildLLVMModule(astNode *root) {
 
     // Add load+ret in return block
     LLVMPositionBuilderAtEnd(builder, retBB);
+    setDebugLoc(builder, fnNode);
     LLVMValueRef loadedRet = LLVMBuildLoad2(builder, i32Ty(), ret_ref, "retload");
     LLVMBuildRet(builder, loadedRet);
 
@@ -465,6 +621,7 @@ LLVMModuleRef BuildLLVMModule(astNode *root) {
 
     // Cleanup per-function state
     LLVMDisposeBuilder(builder);
+    endDebugInfo();
     var_map.clear();
     ret_ref = nullptr;
     retBB = nullptr;
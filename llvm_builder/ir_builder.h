@@ -12,7 +12,12 @@
 
 /*
  * Builds LLVM IR for the whole program AST and returns the LLVM module.
+ * The module targets the host triple and data layout. march selects the CPU
+ * recorded in the function's target-cpu attribute: NULL or "native" uses the
+ * host CPU and its features, anything else is taken as a CPU name.
+ * When debugFile names the source file, DWARF line tables are emitted and
+ * every instruction carries the location of the AST node it came from.
  */
-LLVMModuleRef BuildLLVMModule(astNode *root);
+LLVMModuleRef BuildLLVMModule(astNode *root, const char *march = NULL, const char *debugFile = NULL);
 
 #endif
\ No newline at end of file
@@ -25,18 +25,34 @@ extern astNode *root;
 
 /* Print simple usage message */
 static void printUsage() {
-    printf("Usage: ./compiler <input_file>\n");
+    printf("Usage: ./compiler [-g] [--march=native|<cpu>] <input_file>\n");
 }
 
 /* Entry point */
 int main(int argc, char **argv) {
 
-    if (argc != 2) {
+    const char *filename = NULL;
+    const char *march = NULL;
+    bool debugInfo = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-g") == 0) {
+            debugInfo = true;
+        } else if (strncmp(argv[i], "--march=", 8) == 0) {
+            march = argv[i] + 8;
+        } else if (filename == NULL) {
+            filename = argv[i];
+        } else {
+            filename = NULL;
+            break;
+        }
+    }
+
+    if (filename == NULL || (march != NULL && march[0] == '\0')) {
         printUsage();
         return 1;
     }
 
-    const char *filename = argv[1];
     yyin = fopen(filename, "r");
 
     if (!yyin) {
@@ -62,7 +78,7 @@ int main(int argc, char **argv) {
     RenameVariablesUnique(root);
 
     // Build LLVM IR
-    LLVMModuleRef module = BuildLLVMModule(root);
+    LLVMModuleRef module = BuildLLVMModule(root, march, debugInfo ? filename : NULL);
     if (!module) {
         printf("IR builder failed.\n");
         fclose(yyin);
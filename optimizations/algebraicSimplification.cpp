@@ -0,0 +1,352 @@
+/*
+ * algebraicSimplification.cpp
+ *
+ * Algebraic rewrites of integer arithmetic whose operands are not all
+ * constants. Passes in this file:
+ *  1) Peephole simplification ("peephole" in pipelines): a table of
+ *     identities such as x+0, x*1, x*0, x-x and 0-(0-x), plus multiplying
+ *     by a power of two as a shift
+ *  2) Reassociation ("reassociate" in pipelines): flattens chains of one
+ *     associative, commutative operation and combines their constants, so
+ *     (a+3)+5 becomes a+8
+ *
+ * Both rely on wrapping two's complement arithmetic: the rewritten
+ * instructions drop nsw/nuw, so they are exact for every input.
+ */
+
+#include <algorithm>
+
+#include <llvm-c/Core.h>
+#include <llvm/ADT/APInt.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Instructions.h>
+
+#include "constantEvaluation.h"
+#include "passManager.h"
+
+using namespace llvm;
+
+/* Constant right operand of `I`, or nullptr. */
+static ConstantInt* constantRHS(BinaryOperator& I) {
+  return dyn_cast<ConstantInt>(I.getOperand(1));
+}
+
+static bool rhsIsZero(BinaryOperator& I) {
+  ConstantInt* c = constantRHS(I);
+  return c && c->isZero();
+}
+
+static bool rhsIsOne(BinaryOperator& I) {
+  ConstantInt* c = constantRHS(I);
+  return c && c->isOne();
+}
+
+static bool rhsIsAllOnes(BinaryOperator& I) {
+  ConstantInt* c = constantRHS(I);
+  return c && c->isMinusOne();
+}
+
+static Value* zeroOf(BinaryOperator& I) {
+  return ConstantInt::get(I.getType(), 0);
+}
+
+/*
+ * Rules return the value that replaces `I`, or nullptr when they do not
+ * apply. A rule may insert new instructions before `I`. Commutative
+ * operations have their constant operand moved to the right first.
+ */
+static Value* addZero(BinaryOperator& I) { return rhsIsZero(I) ? I.getOperand(0) : nullptr; }
+
+static Value* subZero(BinaryOperator& I) { return rhsIsZero(I) ? I.getOperand(0) : nullptr; }
+
+static Value* subSelf(BinaryOperator& I) {
+  return I.getOperand(0) == I.getOperand(1) ? zeroOf(I) : nullptr;
+}
+
+/* 0 - (0 - x) -> x */
+static Value* doubleNegation(BinaryOperator& I) {
+  ConstantInt* lhs = dyn_cast<ConstantInt>(I.getOperand(0));
+  BinaryOperator* inner = dyn_cast<BinaryOperator>(I.getOperand(1));
+  if (!lhs || !lhs->isZero() || !inner || inner->getOpcode() != Instruction::Sub) return nullptr;
+
+  ConstantInt* innerLHS = dyn_cast<ConstantInt>(inner->getOperand(0));
+  return innerLHS && innerLHS->isZero() ? inner->getOperand(1) : nullptr;
+}
+
+static Value* mulZero(BinaryOperator& I) { return rhsIsZero(I) ? zeroOf(I) : nullptr; }
+
+static Value* mulOne(BinaryOperator& I) { return rhsIsOne(I) ? I.getOperand(0) : nullptr; }
+
+/* x * 2^k -> x << k */
+static Value* mulPowerOfTwo(BinaryOperator& I) {
+  ConstantInt* c = constantRHS(I);
+  if (!c || !c->getValue().isPowerOf2() || c->isOne()) return nullptr;
+
+  Constant* shift = ConstantInt::get(I.getType(), c->getValue().exactLogBase2());
+  BinaryOperator* shl = BinaryOperator::Create(Instruction::Shl, I.getOperand(0), shift, "", &I);
+  shl->takeName(&I);
+  return shl;
+}
+
+static Value* andZero(BinaryOperator& I) { return rhsIsZero(I) ? zeroOf(I) : nullptr; }
+
+static Value* andAllOnes(BinaryOperator& I) { return rhsIsAllOnes(I) ? I.getOperand(0) : nullptr; }
+
+static Value* orZero(BinaryOperator& I) { return rhsIsZero(I) ? I.getOperand(0) : nullptr; }
+
+static Value* orAllOnes(BinaryOperator& I) { return rhsIsAllOnes(I) ? I.getOperand(1) : nullptr; }
+
+/* x & x and x | x -> x */
+static Value* idempotent(BinaryOperator& I) {
+  return I.getOperand(0) == I.getOperand(1) ? I.getOperand(0) : nullptr;
+}
+
+static Value* xorZero(BinaryOperator& I) { return rhsIsZero(I) ? I.getOperand(0) : nullptr; }
+
+static Value* xorSelf(BinaryOperator& I) {
+  return I.getOperand(0) == I.getOperand(1) ? zeroOf(I) : nullptr;
+}
+
+static Value* shiftZero(BinaryOperator& I) { return rhsIsZero(I) ? I.getOperand(0) : nullptr; }
+
+static Value* divideOne(BinaryOperator& I) { return rhsIsOne(I) ? I.getOperand(0) : nullptr; }
+
+static Value* remainderOne(BinaryOperator& I) { return rhsIsOne(I) ? zeroOf(I) : nullptr; }
+
+struct PeepholeRule {
+  unsigned opcode;
+  Value* (*rewrite)(BinaryOperator& I);
+};
+
+/* Tried in order; the first rule that applies wins. Add new identities here. */
+static const PeepholeRule peepholeRules[] = {
+  {Instruction::Add, addZero},
+  {Instruction::Sub, subZero},
+  {Instruction::Sub, subSelf},
+  {Instruction::Sub, doubleNegation},
+  {Instruction::Mul, mulZero},
+  {Instruction::Mul, mulOne},
+  {Instruction::Mul, mulPowerOfTwo},
+  {Instruction::And, andZero},
+  {Instruction::And, andAllOnes},
+  {Instruction::And, idempotent},
+  {Instruction::Or, orZero},
+  {Instruction::Or, orAllOnes},
+  {Instruction::Or, idempotent},
+  {Instruction::Xor, xorZero},
+  {Instruction::Xor, xorSelf},
+  {Instruction::Shl, shiftZero},
+  {Instruction::LShr, shiftZero},
+  {Instruction::AShr, shiftZero},
+  {Instruction::SDiv, divideOne},
+  {Instruction::UDiv, divideOne},
+  {Instruction::SRem, remainderOne},
+  {Instruction::URem, remainderOne},
+};
+
+/*
+ * Peephole Simplification
+ * Applies the rule table to every integer binary operator. When an
+ * instruction is replaced, its users are tried again, since x-(y-y) only
+ * matches x-0 once y-y is gone.
+ */
+bool peepholeSimplification(LLVMValueRef function) {
+  SmallVector<BinaryOperator*, 64> worklist;
+  DenseSet<Instruction*> replaced;
+  bool changed = false;
+
+  for (BasicBlock& bb : *unwrap<Function>(function)) {
+    for (Instruction& I : bb) {
+      BinaryOperator* bo = dyn_cast<BinaryOperator>(&I);
+      if (bo && bo->getType()->isIntegerTy()) worklist.push_back(bo);
+    }
+  }
+  std::reverse(worklist.begin(), worklist.end());
+
+  SmallVector<Instruction*, 16> dead;
+  while (!worklist.empty()) {
+    BinaryOperator* I = worklist.pop_back_val();
+    if (replaced.count(I)) continue;
+
+    if (I->isCommutative() && isa<ConstantInt>(I->getOperand(0)) && !isa<ConstantInt>(I->getOperand(1))) {
+      I->swapOperands();
+      changed = true;  // kept even if no rule fires
+    }
+
+    Value* v = nullptr;
+    for (const PeepholeRule& rule : peepholeRules) {
+      if (rule.opcode == I->getOpcode() && (v = rule.rewrite(*I))) break;
+    }
+    if (!v || v == I) continue;
+
+    for (User* user : I->users()) {
+      BinaryOperator* bo = dyn_cast<BinaryOperator>(user);
+      if (bo && !replaced.count(bo)) worklist.push_back(bo);
+    }
+    if (BinaryOperator* bo = dyn_cast<BinaryOperator>(v)) worklist.push_back(bo);
+
+    I->replaceAllUsesWith(v);
+    replaced.insert(I);
+    dead.push_back(I);
+    passCounters.instructionsFolded++;
+  }
+
+  // Erased last, so the worklist never holds a deleted instruction
+  for (Instruction* I : dead) I->eraseFromParent();
+  passCounters.instructionsDeleted += dead.size();
+  return changed || !dead.empty();
+}
+
+static bool isAssociative(unsigned op) {
+  return op == Instruction::Add || op == Instruction::Mul || op == Instruction::And ||
+         op == Instruction::Or || op == Instruction::Xor;
+}
+
+/* Operation of the chain `v` can be part of; x - C counts as x + (-C). */
+static unsigned chainOpcode(Value* v) {
+  BinaryOperator* bo = dyn_cast<BinaryOperator>(v);
+  if (!bo || !bo->getType()->isIntegerTy()) return 0;
+  if (isAssociative(bo->getOpcode())) return bo->getOpcode();
+  if (bo->getOpcode() == Instruction::Sub && isa<ConstantInt>(bo->getOperand(1))) return Instruction::Add;
+  return 0;
+}
+
+/*
+ * True if `v` is folded into the chain of its only user. Chains stay within
+ * a block, so rebuilding one never moves work into a loop.
+ */
+static bool isInnerNode(Value* v, unsigned op) {
+  if (chainOpcode(v) != op || !v->hasOneUse() || chainOpcode(v->user_back()) != op) return false;
+  return cast<Instruction>(v)->getParent() == cast<Instruction>(v->user_back())->getParent();
+}
+
+/* Constant that leaves the other operand unchanged (0 for add, 1 for mul, ...). */
+static bool isIdentity(unsigned op, const APInt& c) {
+  if (op == Instruction::Mul) return c.isOne();
+  if (op == Instruction::And) return c.isAllOnes();
+  return c.isZero();
+}
+
+/* Constant that makes the result constant (0 for mul and and, all ones for or). */
+static bool isAbsorbing(unsigned op, const APInt& c) {
+  if (op == Instruction::Mul || op == Instruction::And) return c.isZero();
+  if (op == Instruction::Or) return c.isAllOnes();
+  return false;
+}
+
+/* A flattened chain: the nodes from the root down and what they combine. */
+struct Chain {
+  unsigned op = 0;
+  SmallVector<BinaryOperator*, 8> nodes;
+  SmallVector<Value*, 8> leaves;  // non-constant operands
+  APInt constant;                 // all constant operands combined
+  unsigned constants = 0;
+};
+
+static void addConstant(Chain& chain, const APInt& c) {
+  if (chain.constants++ == 0) chain.constant = c;
+  else foldBinary(chain.op, chain.constant, c, chain.constant);
+}
+
+static void flatten(BinaryOperator* root, Chain& chain) {
+  chain.op = chainOpcode(root);
+  SmallVector<Value*, 8> stack = {root};
+
+  while (!stack.empty()) {
+    Value* v = stack.pop_back_val();
+    BinaryOperator* node = dyn_cast<BinaryOperator>(v);
+
+    if (node && (node == root || isInnerNode(node, chain.op))) {
+      chain.nodes.push_back(node);
+      if (node->getOpcode() == Instruction::Sub) {
+        // x - C: the constant goes in negated
+        addConstant(chain, -cast<ConstantInt>(node->getOperand(1))->getValue());
+        stack.push_back(node->getOperand(0));
+      } else {
+        stack.push_back(node->getOperand(1));
+        stack.push_back(node->getOperand(0));
+      }
+    } else if (ConstantInt* c = dyn_cast<ConstantInt>(v)) {
+      addConstant(chain, c->getValue());
+    } else {
+      chain.leaves.push_back(v);
+    }
+  }
+}
+
+/*
+ * Reassociation
+ * Flattens each chain of add (and subtraction of a constant), mul, and, or
+ * or xor whose inner results have no other use, and rebuilds it when that
+ * combines constants: the non-constant operands ordered by rank (arguments
+ * first, then instructions in layout order, so values defined earlier
+ * combine first) and one folded constant last. Chains with a single
+ * non-trivial constant are left as they are.
+ */
+bool reassociateExpressions(LLVMValueRef function) {
+  Function& F = *unwrap<Function>(function);
+
+  DenseMap<Value*, unsigned> rank;
+  unsigned next = 1;
+  for (Argument& arg : F.args()) rank[&arg] = next++;
+
+  SmallVector<BinaryOperator*, 32> roots;
+  for (BasicBlock& bb : F) {
+    for (Instruction& I : bb) {
+      rank[&I] = next++;
+      unsigned op = chainOpcode(&I);
+      if (op && !isInnerNode(&I, op)) roots.push_back(cast<BinaryOperator>(&I));
+    }
+  }
+
+  bool changed = false;
+  for (BinaryOperator* root : roots) {
+    Chain chain;
+    flatten(root, chain);
+
+    bool absorbing = chain.constants > 0 && isAbsorbing(chain.op, chain.constant);
+    bool identity = chain.constants > 0 && isIdentity(chain.op, chain.constant);
+    if (chain.constants < 2 && !absorbing && !identity) continue;
+
+    std::stable_sort(chain.leaves.begin(), chain.leaves.end(), [&](Value* a, Value* b) {
+      return rank.lookup(a) < rank.lookup(b);
+    });
+
+    // New instructions take the root's rank, and the last one its name
+    Instruction::BinaryOps op = (Instruction::BinaryOps)chain.op;
+    Value* v = nullptr;
+    BinaryOperator* last = nullptr;
+    if (absorbing || chain.leaves.empty()) {
+      v = ConstantInt::get(root->getType(), chain.constant);
+    } else {
+      v = chain.leaves[0];
+      for (size_t i = 1; i < chain.leaves.size(); i++) {
+        v = last = BinaryOperator::Create(op, v, chain.leaves[i], "reass", root);
+        rank[last] = rank[root];
+      }
+      if (!identity) {
+        v = last = BinaryOperator::Create(op, v, ConstantInt::get(root->getType(), chain.constant), "reass", root);
+        rank[last] = rank[root];
+      }
+    }
+    if (last) last->takeName(root);
+
+    // Each node's only use is the one above it, so erasing top-down works
+    root->replaceAllUsesWith(v);
+    for (BinaryOperator* node : chain.nodes) {
+      rank.erase(node);
+      node->eraseFromParent();
+    }
+
+    passCounters.instructionsFolded += chain.constants > 0 ? chain.constants - 1 : 0;
+    passCounters.instructionsDeleted += chain.nodes.size();
+    changed = true;
+  }
+
+  return changed;
+}
@@ -0,0 +1,242 @@
+/*
+ * analysisManager.cpp
+ *
+ * Computes and caches the per-function analyses declared in analysisManager.h.
+ * Reaching stores are a forward, union-meet bit-vector problem solved with
+ * the framework in dataflow.h; calls and stores through pointers that may
+ * alias are modelled with the clobbered facts described in analysisManager.h.
+ */
+
+#include <llvm/IR/Instruction.h>
+#include <llvm/IR/Instructions.h>
+
+#include "analysisManager.h"
+#include "passManager.h"
+
+static thread_local FunctionAnalyses currentAnalyses;
+
+static bool isStore(LLVMValueRef I) {
+  return LLVMGetInstructionOpcode(I) == LLVMStore;
+}
+
+static LLVMValueRef storePointer(LLVMValueRef storeInst) {
+  return LLVMGetOperand(storeInst, 1);
+}
+
+bool isLocalSlot(LLVMValueRef pointer) {
+  if (!LLVMIsAAllocaInst(pointer)) return false;
+
+  for (LLVMUseRef use = LLVMGetFirstUse(pointer); use != nullptr; use = LLVMGetNextUse(use)) {
+    LLVMValueRef user = LLVMGetUser(use);
+    if (LLVMGetInstructionOpcode(user) == LLVMLoad) continue;
+    if (!isStore(user) || LLVMGetOperand(user, 0) == pointer) return false;
+  }
+  return true;
+}
+
+bool isSideEffect(LLVMValueRef instruction) {
+  const llvm::Instruction* I = llvm::unwrap<llvm::Instruction>(instruction);
+  return I->mayHaveSideEffects() || I->isTerminator() || llvm::isa<llvm::AllocaInst>(I);
+}
+
+/* Marks every non-local address as clobbered, dropping the stores to them. */
+static void clobberEscaping(const StoreIndex& numbering, FactSet& R) {
+  R.subtract(numbering.escapingMask);
+  R.unionWith(numbering.clobberedMask);
+}
+
+void StoreIndex::step(LLVMValueRef I, FactSet& R) const {
+  if (isStore(I)) {
+    unsigned s = index.at(I);
+    unsigned a = addressOf[s];
+    if (clobberedFact[a] >= 0) {
+      // May alias every other non-local address
+      clobberEscaping(*this, R);
+      R.reset(clobberedFact[a]);
+    } else {
+      R.subtract(storesToMask[a]);
+    }
+    R.set(s);
+    return;
+  }
+
+  if (llvm::unwrap<llvm::Instruction>(I)->mayWriteToMemory()) clobberEscaping(*this, R);
+}
+
+/*
+ * Computes GEN and KILL for reaching stores by running each block's
+ * instructions through StoreIndex::step: from the empty set the block
+ * leaves GEN, and from the full set it leaves everything but KILL. The
+ * entry block starts by clobbering every non-local address.
+ */
+static void computeGenKill(const BlockGraph& g, const StoreIndex& numbering,
+                           std::vector<FactSet>& gen, std::vector<FactSet>& kill) {
+  size_t bits = numbering.facts;
+  gen.assign(g.blocks.size(), FactSet(bits));
+  kill.assign(g.blocks.size(), FactSet(bits));
+
+  for (unsigned b = 0; b < g.blocks.size(); b++) {
+    FactSet survivors(bits, true);
+    if (b == 0) {
+      clobberEscaping(numbering, gen[b]);
+      clobberEscaping(numbering, survivors);
+    }
+
+    for (LLVMValueRef I = LLVMGetFirstInstruction(g.blocks[b]);
+         I != nullptr;
+         I = LLVMGetNextInstruction(I)) {
+      numbering.step(I, gen[b]);
+      numbering.step(I, survivors);
+    }
+
+    kill[b] = FactSet(bits, true);
+    kill[b].subtract(survivors);
+  }
+}
+
+void FunctionAnalyses::reset(LLVMValueRef function) {
+  fn = function;
+  valid = 0;
+  blockList.clear();
+  graph = BlockGraph();
+  domTree = BlockDominators();
+  frontiers.clear();
+  loopForest = LoopForest();
+  storeIndex = StoreIndex();
+  reachingIn.clear();
+}
+
+const std::vector<LLVMBasicBlockRef>& FunctionAnalyses::blocks() {
+  if (valid & AnalysisBlocks) return blockList;
+
+  blockList.clear();
+  for (LLVMBasicBlockRef b = LLVMGetFirstBasicBlock(fn);
+       b != nullptr;
+       b = LLVMGetNextBasicBlock(b)) {
+    blockList.push_back(b);
+  }
+
+  valid |= AnalysisBlocks;
+  return blockList;
+}
+
+const BlockGraph& FunctionAnalyses::cfg() {
+  if (valid & AnalysisCFG) return graph;
+
+  buildBlockGraph(blocks(), graph);
+  valid |= AnalysisCFG;
+  return graph;
+}
+
+const BlockDominators& FunctionAnalyses::dominators() {
+  if (valid & AnalysisDominators) return domTree;
+
+  computeDominators(cfg(), domTree);
+  valid |= AnalysisDominators;
+  return domTree;
+}
+
+const std::vector<std::vector<unsigned>>& FunctionAnalyses::dominanceFrontiers() {
+  if (valid & AnalysisFrontiers) return frontiers;
+
+  computeDominanceFrontiers(cfg(), dominators(), frontiers);
+  valid |= AnalysisFrontiers;
+  return frontiers;
+}
+
+const LoopForest& FunctionAnalyses::loops() {
+  if (valid & AnalysisLoops) return loopForest;
+
+  computeLoops(cfg(), dominators(), loopForest);
+  valid |= AnalysisLoops;
+  return loopForest;
+}
+
+const StoreIndex& FunctionAnalyses::stores() {
+  if (valid & AnalysisStores) return storeIndex;
+
+  // Number all store instructions in program order, grouping by address
+  storeIndex = StoreIndex();
+  for (LLVMBasicBlockRef b : blocks()) {
+    for (LLVMValueRef I = LLVMGetFirstInstruction(b);
+         I != nullptr;
+         I = LLVMGetNextInstruction(I)) {
+      if (!isStore(I)) continue;
+
+      unsigned s = storeIndex.stores.size();
+      auto inserted = storeIndex.addresses.insert({storePointer(I), storeIndex.storesTo.size()});
+      if (inserted.second) storeIndex.storesTo.push_back({});
+
+      storeIndex.index[I] = s;
+      storeIndex.stores.push_back(I);
+      storeIndex.addressOf.push_back(inserted.first->second);
+      storeIndex.storesTo[inserted.first->second].push_back(s);
+    }
+  }
+
+  // Non-local addresses get a clobbered fact after the stores
+  size_t numStores = storeIndex.stores.size();
+  size_t bits = numStores;
+  storeIndex.clobberedFact.assign(storeIndex.storesTo.size(), -1);
+  for (unsigned a = 0; a < storeIndex.storesTo.size(); a++) {
+    LLVMValueRef pointer = storePointer(storeIndex.stores[storeIndex.storesTo[a][0]]);
+    if (!isLocalSlot(pointer)) storeIndex.clobberedFact[a] = bits++;
+  }
+  storeIndex.facts = bits;
+
+  storeIndex.storesToMask.assign(storeIndex.storesTo.size(), FactSet(bits));
+  storeIndex.escapingMask = FactSet(bits);
+  storeIndex.clobberedMask = FactSet(bits);
+  for (unsigned s = 0; s < numStores; s++) {
+    unsigned a = storeIndex.addressOf[s];
+    storeIndex.storesToMask[a].set(s);
+    if (storeIndex.clobberedFact[a] >= 0) storeIndex.escapingMask.set(s);
+  }
+  for (unsigned a = 0; a < storeIndex.storesTo.size(); a++) {
+    int fact = storeIndex.clobberedFact[a];
+    if (fact < 0) continue;
+    storeIndex.storesToMask[a].set(fact);
+    storeIndex.escapingMask.set(fact);
+    storeIndex.clobberedMask.set(fact);
+  }
+
+  valid |= AnalysisStores;
+  return storeIndex;
+}
+
+const std::vector<FactSet>& FunctionAnalyses::reachingStoresIn() {
+  if (valid & AnalysisReachingStores) return reachingIn;
+
+  const BlockGraph& g = cfg();
+  const StoreIndex& numbering = stores();
+
+  std::vector<FactSet> gen, kill, out;
+  computeGenKill(g, numbering, gen, kill);
+  passCounters.dataflowSweeps += DataflowSolver<DataflowDirection::Forward, UnionMeet>::solve(
+      g, numbering.facts, gen, kill, reachingIn, out);
+
+  // GEN of the entry block already holds the clobbering on entry; IN shows it too
+  if (!reachingIn.empty()) reachingIn[0].unionWith(numbering.clobberedMask);
+
+  valid |= AnalysisReachingStores;
+  return reachingIn;
+}
+
+void FunctionAnalyses::invalidate(unsigned preserved) {
+  valid &= preserved;
+
+  // Derived analyses go with what they were computed from
+  if (!(valid & AnalysisBlocks)) valid &= ~(AnalysisCFG | AnalysisStores);
+  if (!(valid & AnalysisCFG)) valid &= ~AnalysisDominators;
+  if (!(valid & AnalysisDominators)) valid &= ~(AnalysisFrontiers | AnalysisLoops);
+  if (!(valid & AnalysisCFG) || !(valid & AnalysisStores)) valid &= ~AnalysisReachingStores;
+}
+
+FunctionAnalyses& analysesFor(LLVMValueRef function) {
+  if (currentAnalyses.function() != function) currentAnalyses.reset(function);
+  return currentAnalyses;
+}
+
+void resetAnalyses() {
+  currentAnalyses.reset(nullptr);
+}
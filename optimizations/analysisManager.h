@@ -0,0 +1,123 @@
+/*
+ * analysisManager.h
+ *
+ * Per-function cache of the analyses the optimizer passes share: block
+ * order, the numbered CFG, dominators, dominance frontiers, loops, store
+ * numbering and reaching stores. An analysis
+ * is computed on first use and kept until a pass that does not preserve it
+ * changes the function.
+ */
+
+#ifndef ANALYSIS_MANAGER_H
+#define ANALYSIS_MANAGER_H
+
+#include <unordered_map>
+#include <vector>
+
+#include <llvm-c/Core.h>
+
+#include "controlFlow.h"
+#include "dataflow.h"
+
+/* Bits naming each cached analysis; passes declare a mask of the ones they preserve. */
+enum CachedAnalysis : unsigned {
+  AnalysisBlocks = 1u << 0,          // blocks in layout order
+  AnalysisCFG = 1u << 1,             // numbered blocks, edges, reverse postorder
+  AnalysisStores = 1u << 2,          // stores numbered in program order
+  AnalysisReachingStores = 1u << 3,  // stores reaching each block entry
+  AnalysisDominators = 1u << 4,      // dominator tree
+  AnalysisFrontiers = 1u << 5,       // dominance frontiers
+  AnalysisLoops = 1u << 6,           // natural loop forest
+};
+
+const unsigned PreservesNone = 0;
+const unsigned PreservesAll = ~0u;
+
+/*
+ * Store numbering. Reaching-store bit vectors are indexed by these numbers,
+ * so iteration order follows the program rather than instruction addresses.
+ * Stores are also grouped by the address they write.
+ *
+ * An address other code may write (anything but an alloca that is only
+ * loaded and stored) gets one more fact after the stores: "clobbered". It is
+ * generated on function entry, by calls and other writes to memory, and by
+ * stores to any other such address, since the two may alias. A load whose
+ * address is clobbered may see a value no store in the function wrote.
+ */
+struct StoreIndex {
+  std::vector<LLVMValueRef> stores;                     // number -> store
+  std::unordered_map<LLVMValueRef, unsigned> index;     // store -> number
+  std::vector<unsigned> addressOf;                      // store number -> address number
+  std::unordered_map<LLVMValueRef, unsigned> addresses; // pointer -> address number
+  std::vector<std::vector<unsigned>> storesTo;          // address number -> store numbers
+  std::vector<FactSet> storesToMask;                    // same, as a bit vector, plus its clobbered fact
+  std::vector<int> clobberedFact;                       // address number -> fact, -1 for local slots
+  FactSet escapingMask;                                 // stores and clobbered facts of non-local addresses
+  FactSet clobberedMask;                                // every clobbered fact
+  size_t facts = 0;                                     // bits in a reaching-stores set
+
+  /* Updates the running reaching set `R` for instruction `I`. */
+  void step(LLVMValueRef I, FactSet& R) const;
+
+  /* True if something other than this function's stores may have written `address`. */
+  bool clobbered(unsigned address, const FactSet& R) const {
+    return clobberedFact[address] >= 0 && R.test(clobberedFact[address]);
+  }
+};
+
+/*
+ * Returns true if `pointer` is an alloca that is only loaded from and stored
+ * to, so no call or store through another pointer can change it.
+ */
+bool isLocalSlot(LLVMValueRef pointer);
+
+/*
+ * Returns true if `instruction` must not be deleted even when unused: it may
+ * write memory, trap or not return (stores, calls, volatile and atomic
+ * accesses, fences), or it is a terminator or an alloca.
+ */
+bool isSideEffect(LLVMValueRef instruction);
+
+class FunctionAnalyses {
+public:
+  /* Starts caching for `function`, dropping anything cached before. */
+  void reset(LLVMValueRef function);
+
+  LLVMValueRef function() const { return fn; }
+
+  const std::vector<LLVMBasicBlockRef>& blocks();
+  const BlockGraph& cfg();
+  const BlockDominators& dominators();
+  const std::vector<std::vector<unsigned>>& dominanceFrontiers();
+  const LoopForest& loops();
+  const StoreIndex& stores();
+
+  /* IN sets of the reaching-stores problem, indexed by cfg() block number. */
+  const std::vector<FactSet>& reachingStoresIn();
+
+  /* Drops every analysis not named in `preserved`, plus anything derived from one. */
+  void invalidate(unsigned preserved);
+
+private:
+  LLVMValueRef fn = nullptr;
+  unsigned valid = 0;
+
+  std::vector<LLVMBasicBlockRef> blockList;
+  BlockGraph graph;
+  BlockDominators domTree;
+  std::vector<std::vector<unsigned>> frontiers;
+  LoopForest loopForest;
+  StoreIndex storeIndex;
+  std::vector<FactSet> reachingIn;
+};
+
+/*
+ * Cache for the function the calling thread is optimizing. Switching to a
+ * different function resets it.
+ */
+FunctionAnalyses& analysesFor(LLVMValueRef function);
+
+/* Drops the calling thread's cache (call when done with a function). */
+void resetAnalyses();
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * cfgSimplification.cpp
+ *
+ * CFG simplification ("simplifycfg" in pipelines). The IR builder leaves
+ * many blocks that only branch on (if.end, while.end, if.else_or_end), and
+ * folding constant branches leaves chains of blocks joined by unconditional
+ * branches. Repeats until nothing changes:
+ *  1) deletes blocks that cannot be reached
+ *  2) folds branches on a constant and branches whose two targets match
+ *  3) removes empty blocks that only branch elsewhere, sending their
+ *     predecessors straight to the target
+ *  4) merges a block into its sole predecessor when that predecessor only
+ *     branches to it
+ *  5) merges blocks that return the same value, so only one return path is
+ *     left for each
+ */
+
+#include <vector>
+
+#include <llvm-c/Core.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SetVector.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+
+#include "controlFlowEdits.h"
+#include "passManager.h"
+
+using namespace llvm;
+
+/* Erases `bb`, which no longer has predecessors or instructions other than its terminator. */
+static void eraseBlock(BasicBlock* bb) {
+  passCounters.instructionsDeleted += bb->size();
+  passCounters.blocksDeleted++;
+  bb->eraseFromParent();
+}
+
+/*
+ * Erases `v` if it is an instruction without uses or side effects, then
+ * the operands that leaves unused, and so on.
+ */
+static void eraseIfDead(Value* v) {
+  SmallVector<Instruction*, 8> worklist;
+  if (Instruction* I = dyn_cast<Instruction>(v)) worklist.push_back(I);
+
+  while (!worklist.empty()) {
+    Instruction* I = worklist.pop_back_val();
+    if (!I->use_empty() || I->mayHaveSideEffects() || I->isTerminator()) continue;
+
+    SmallSetVector<Instruction*, 4> operands;
+    for (Value* operand : I->operands()) {
+      if (Instruction* def = dyn_cast<Instruction>(operand)) operands.insert(def);
+    }
+    I->eraseFromParent();
+    passCounters.instructionsDeleted++;
+    worklist.append(operands.begin(), operands.end());
+  }
+}
+
+/*
+ * Rewrites `br i1 %c, label %a, label %a` as `br label %a`; the two edges
+ * carry the same phi operands, so one of them is dropped. %c is erased if
+ * the branch was its only use.
+ */
+static bool foldSameTargetBranch(BasicBlock* bb) {
+  BranchInst* br = dyn_cast<BranchInst>(bb->getTerminator());
+  if (!br || br->isUnconditional() || br->getSuccessor(0) != br->getSuccessor(1)) return false;
+
+  BasicBlock* target = br->getSuccessor(0);
+  for (PHINode& phi : target->phis()) phi.removeIncomingValue(bb, false);
+
+  Value* condition = br->getCondition();
+  BranchInst::Create(target, br);
+  br->eraseFromParent();
+  eraseIfDead(condition);
+  passCounters.branchesFolded++;
+  return true;
+}
+
+/*
+ * Removes `bb` if it holds only `br label %target`, moving its predecessors
+ * to `target`. Not done when a predecessor already branches to `target`
+ * and a phi there would need two different values for it.
+ */
+static bool removeForwardingBlock(BasicBlock* bb) {
+  if (bb->isEntryBlock() || bb->hasAddressTaken() || bb->size() != 1) return false;
+
+  BranchInst* br = dyn_cast<BranchInst>(bb->getTerminator());
+  if (!br || !br->isUnconditional()) return false;
+  BasicBlock* target = br->getSuccessor(0);
+  if (target == bb) return false;
+
+  // One entry per edge: a predecessor may branch to bb twice
+  SmallVector<BasicBlock*, 4> preds(predecessors(bb));
+  if (preds.empty()) return false;
+
+  for (PHINode& phi : target->phis()) {
+    Value* v = phi.getIncomingValueForBlock(bb);
+    for (BasicBlock* pred : preds) {
+      int existing = phi.getBasicBlockIndex(pred);
+      if (existing >= 0 && phi.getIncomingValue(existing) != v) return false;
+    }
+  }
+
+  for (PHINode& phi : target->phis()) {
+    Value* v = phi.getIncomingValueForBlock(bb);
+    phi.removeIncomingValue(bb, false);
+    for (BasicBlock* pred : preds) phi.addIncoming(v, pred);
+  }
+
+  DenseMap<BasicBlock*, bool> redirected;
+  for (BasicBlock* pred : preds) {
+    if (redirected[pred]) continue;
+    redirected[pred] = true;
+    pred->getTerminator()->replaceSuccessorWith(bb, target);
+  }
+
+  eraseBlock(bb);
+  return true;
+}
+
+/*
+ * Appends `bb` to its sole predecessor when that predecessor's only
+ * successor is `bb`.
+ */
+static bool mergeIntoPredecessor(BasicBlock* bb) {
+  if (bb->isEntryBlock() || bb->hasAddressTaken()) return false;
+
+  BasicBlock* pred = bb->getSinglePredecessor();
+  if (!pred || pred == bb) return false;
+  BranchInst* br = dyn_cast<BranchInst>(pred->getTerminator());
+  if (!br || !br->isUnconditional()) return false;
+
+  // With one predecessor a phi has one operand; a phi naming itself only
+  // happens in unreachable code
+  for (PHINode& phi : bb->phis()) {
+    if (phi.getIncomingValue(0) == &phi) return false;
+  }
+  while (PHINode* phi = dyn_cast<PHINode>(&bb->front())) {
+    phi->replaceAllUsesWith(phi->getIncomingValue(0));
+    phi->eraseFromParent();
+    passCounters.instructionsDeleted++;
+  }
+
+  // Phis in the successors now see the edge coming from pred
+  for (BasicBlock* succ : successors(bb)) {
+    for (PHINode& phi : succ->phis()) {
+      for (unsigned i = 0; i < phi.getNumIncomingValues(); i++) {
+        if (phi.getIncomingBlock(i) == bb) phi.setIncomingBlock(i, pred);
+      }
+    }
+  }
+
+  br->eraseFromParent();
+  while (!bb->empty()) bb->front().moveBefore(*pred, pred->end());
+  passCounters.instructionsDeleted++;  // the branch
+  passCounters.blocksDeleted++;
+  bb->eraseFromParent();
+  return true;
+}
+
+/*
+ * Sends every branch to a block holding only `ret v` to the first such
+ * block with the same `v`, then deletes the copies.
+ */
+static bool mergeReturnBlocks(Function& F) {
+  DenseMap<Value*, BasicBlock*> first;  // returned value (nullptr for void) -> block
+  SmallVector<BasicBlock*, 4> duplicates;
+
+  for (BasicBlock& bb : F) {
+    ReturnInst* ret = dyn_cast<ReturnInst>(bb.getTerminator());
+    if (!ret || bb.size() != 1 || bb.isEntryBlock() || bb.hasAddressTaken()) continue;
+
+    auto inserted = first.insert({ret->getReturnValue(), &bb});
+    if (inserted.second) continue;
+
+    // Only a branch can reach a block without phis, so retargeting is enough
+    SmallVector<BasicBlock*, 4> preds(predecessors(&bb));
+    for (BasicBlock* pred : preds) pred->getTerminator()->replaceSuccessorWith(&bb, inserted.first->second);
+    duplicates.push_back(&bb);
+  }
+
+  for (BasicBlock* bb : duplicates) eraseBlock(bb);
+  return !duplicates.empty();
+}
+
+/*
+ * CFG Simplification
+ * Deletes, forwards and merges blocks until the CFG stops changing; see the
+ * top of this file.
+ */
+bool simplifyControlFlow(LLVMValueRef function) {
+  Function& F = *unwrap<Function>(function);
+  bool changed = false;
+  bool progress = true;
+
+  while (progress) {
+    progress = deleteUnreachableBlocks(F) > 0;
+
+    for (auto it = F.begin(); it != F.end();) {
+      BasicBlock* bb = &*it++;
+
+      BranchInst* br = dyn_cast<BranchInst>(bb->getTerminator());
+      if (br && foldConstantBranch(br)) progress = true;
+      if (foldSameTargetBranch(bb)) progress = true;
+
+      // Both erase bb, which the iterator has already passed
+      if (removeForwardingBlock(bb) || mergeIntoPredecessor(bb)) progress = true;
+    }
+
+    progress |= mergeReturnBlocks(F);
+    changed |= progress;
+  }
+
+  return changed;
+}
@@ -0,0 +1,101 @@
+/*
+ * constantEvaluation.h
+ *
+ * Integer arithmetic on constant operands, shared by cf, prop and sccp.
+ * Results that LLVM leaves undefined (division by zero, INT_MIN / -1,
+ * shifting by the width or more) are never folded, so the instruction stays
+ * and behaves at run time exactly as before.
+ */
+
+#ifndef CONSTANT_EVALUATION_H
+#define CONSTANT_EVALUATION_H
+
+#include <llvm/ADT/APInt.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Instructions.h>
+
+/*
+ * Folds binary operator `op` on `a` and `b`; returns false for other opcodes
+ * and undefined results.
+ */
+inline bool foldBinary(unsigned op, const llvm::APInt& a, const llvm::APInt& b, llvm::APInt& result) {
+  switch (op) {
+    case llvm::Instruction::Add: result = a + b; return true;
+    case llvm::Instruction::Sub: result = a - b; return true;
+    case llvm::Instruction::Mul: result = a * b; return true;
+    case llvm::Instruction::And: result = a & b; return true;
+    case llvm::Instruction::Or: result = a | b; return true;
+    case llvm::Instruction::Xor: result = a ^ b; return true;
+    case llvm::Instruction::SDiv:
+    case llvm::Instruction::SRem:
+      if (b.isZero() || (a.isMinSignedValue() && b.isAllOnes())) return false;
+      result = op == llvm::Instruction::SDiv ? a.sdiv(b) : a.srem(b);
+      return true;
+    case llvm::Instruction::UDiv:
+    case llvm::Instruction::URem:
+      if (b.isZero()) return false;
+      result = op == llvm::Instruction::UDiv ? a.udiv(b) : a.urem(b);
+      return true;
+    case llvm::Instruction::Shl:
+    case llvm::Instruction::LShr:
+    case llvm::Instruction::AShr:
+      if (b.uge(a.getBitWidth())) return false;
+      if (op == llvm::Instruction::Shl) result = a.shl(b);
+      else if (op == llvm::Instruction::LShr) result = a.lshr(b);
+      else result = a.ashr(b);
+      return true;
+    default:
+      return false;
+  }
+}
+
+/* True if evaluateConstant can fold `I` once its operands are constants. */
+inline bool isEvaluable(const llvm::Instruction& I) {
+  if (!I.getType()->isIntegerTy()) return false;
+  if (llvm::isa<llvm::BinaryOperator>(I) || llvm::isa<llvm::ICmpInst>(I)) return true;
+
+  unsigned op = I.getOpcode();
+  return op == llvm::Instruction::ZExt || op == llvm::Instruction::SExt ||
+         op == llvm::Instruction::Trunc;
+}
+
+/*
+ * Value of `I` (see isEvaluable) given the values of its operands, or
+ * nullptr if the result is undefined.
+ */
+inline llvm::ConstantInt* evaluateConstant(const llvm::Instruction& I,
+                                           llvm::ConstantInt* const* operands) {
+  const llvm::APInt& a = operands[0]->getValue();
+  unsigned width = I.getType()->getIntegerBitWidth();
+  llvm::APInt result;
+
+  if (const llvm::ICmpInst* cmp = llvm::dyn_cast<llvm::ICmpInst>(&I)) {
+    result = llvm::APInt(1, llvm::ICmpInst::compare(a, operands[1]->getValue(), cmp->getPredicate()));
+  } else if (I.getOpcode() == llvm::Instruction::ZExt) {
+    result = a.zext(width);
+  } else if (I.getOpcode() == llvm::Instruction::SExt) {
+    result = a.sext(width);
+  } else if (I.getOpcode() == llvm::Instruction::Trunc) {
+    result = a.trunc(width);
+  } else if (!foldBinary(I.getOpcode(), a, operands[1]->getValue(), result)) {
+    return nullptr;
+  }
+  return llvm::ConstantInt::get(I.getContext(), result);
+}
+
+/*
+ * Folds `I` if it is evaluable and all its operands are constant integers;
+ * nullptr otherwise.
+ */
+inline llvm::ConstantInt* foldConstantOperands(const llvm::Instruction& I) {
+  if (!isEvaluable(I)) return nullptr;
+
+  llvm::ConstantInt* operands[2];
+  for (unsigned i = 0; i < I.getNumOperands(); i++) {
+    operands[i] = llvm::dyn_cast<llvm::ConstantInt>(I.getOperand(i));
+    if (!operands[i]) return nullptr;
+  }
+  return evaluateConstant(I, operands);
+}
+
+#endif
@@ -0,0 +1,267 @@
+/*
+ * controlFlow.cpp
+ *
+ * Builds the numbered CFG and computes dominators, dominance frontiers and
+ * natural loops over it. See controlFlow.h.
+ */
+
+#include <algorithm>
+
+#include "controlFlow.h"
+
+/*
+ * Numbers blocks in layout order, records edges from terminator successors
+ * and computes reverse postorder from the entry block.
+ */
+void buildBlockGraph(const std::vector<LLVMBasicBlockRef>& blocks, BlockGraph& g) {
+  size_t n = blocks.size();
+  g.blocks = blocks;
+  g.number.clear();
+  g.preds.assign(n, {});
+  g.succs.assign(n, {});
+  g.order.clear();
+  g.rpoIndex.assign(n, 0);
+  g.numReachable = 0;
+
+  for (unsigned b = 0; b < n; b++) g.number[blocks[b]] = b;
+
+  for (unsigned b = 0; b < n; b++) {
+    LLVMValueRef term = LLVMGetBasicBlockTerminator(blocks[b]);
+    if (!term) continue;
+
+    unsigned numSucc = LLVMGetNumSuccessors(term);
+    for (unsigned i = 0; i < numSucc; i++) {
+      unsigned s = g.number.at(LLVMGetSuccessor(term, i));
+      g.succs[b].push_back(s);
+      g.preds[s].push_back(b);
+    }
+  }
+
+  if (n == 0) return;
+
+  // Iterative DFS; a block is appended to the postorder once all of its
+  // successors have been visited
+  std::vector<bool> visited(n, false);
+  std::vector<std::pair<unsigned, unsigned>> stack;  // block, next successor
+  std::vector<unsigned> postorder;
+
+  visited[0] = true;
+  stack.push_back({0, 0});
+  while (!stack.empty()) {
+    unsigned b = stack.back().first;
+    unsigned& next = stack.back().second;
+
+    if (next < g.succs[b].size()) {
+      unsigned s = g.succs[b][next++];
+      if (!visited[s]) {
+        visited[s] = true;
+        stack.push_back({s, 0});
+      }
+      continue;
+    }
+
+    postorder.push_back(b);
+    stack.pop_back();
+  }
+
+  g.order.assign(postorder.rbegin(), postorder.rend());
+  g.numReachable = g.order.size();
+  for (unsigned b = 0; b < n; b++) {
+    if (!visited[b]) g.order.push_back(b);
+  }
+  for (unsigned p = 0; p < n; p++) g.rpoIndex[g.order[p]] = p;
+}
+
+/*
+ * Walks two blocks up the partial tree until they meet, using reverse
+ * postorder positions to decide which one to move.
+ */
+static unsigned intersect(const BlockGraph& g, const std::vector<int>& doms,
+                          unsigned a, unsigned b) {
+  while (a != b) {
+    while (g.rpoIndex[a] > g.rpoIndex[b]) a = doms[a];
+    while (g.rpoIndex[b] > g.rpoIndex[a]) b = doms[b];
+  }
+  return a;
+}
+
+/*
+ * Cooper-Harvey-Kennedy: iterate idom(b) = intersection of the processed
+ * predecessors' dominators in reverse postorder until nothing changes.
+ */
+void computeDominators(const BlockGraph& g, BlockDominators& dt) {
+  size_t n = g.blocks.size();
+  dt.idom.assign(n, BlockDominators::None);
+  dt.children.assign(n, {});
+  dt.enter.assign(n, 0);
+  dt.leave.assign(n, 0);
+  if (g.numReachable == 0) return;
+
+  unsigned entry = g.order[0];
+  std::vector<int> doms(n, -1);
+  doms[entry] = entry;
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+
+    for (unsigned p = 1; p < g.numReachable; p++) {
+      unsigned b = g.order[p];
+      int newIdom = -1;
+
+      for (unsigned pred : g.preds[b]) {
+        if (doms[pred] < 0) continue;  // not processed yet, or unreachable
+        newIdom = newIdom < 0 ? (int)pred : (int)intersect(g, doms, pred, newIdom);
+      }
+
+      if (doms[b] != newIdom) {
+        doms[b] = newIdom;
+        changed = true;
+      }
+    }
+  }
+
+  for (unsigned p = 1; p < g.numReachable; p++) {
+    unsigned b = g.order[p];
+    dt.idom[b] = doms[b];
+    dt.children[doms[b]].push_back(b);
+  }
+  for (std::vector<unsigned>& c : dt.children) std::sort(c.begin(), c.end());
+
+  // Number the tree depth-first for dominates()
+  unsigned counter = 0;
+  std::vector<std::pair<unsigned, unsigned>> stack;  // block, next child
+  dt.enter[entry] = ++counter;
+  stack.push_back({entry, 0});
+  while (!stack.empty()) {
+    unsigned b = stack.back().first;
+    unsigned& next = stack.back().second;
+
+    if (next < dt.children[b].size()) {
+      unsigned c = dt.children[b][next++];
+      dt.enter[c] = ++counter;
+      stack.push_back({c, 0});
+      continue;
+    }
+
+    dt.leave[b] = ++counter;
+    stack.pop_back();
+  }
+}
+
+/*
+ * For each join point b, every block on the dominator-tree path from a
+ * predecessor up to (not including) idom(b) has b in its frontier.
+ */
+void computeDominanceFrontiers(const BlockGraph& g, const BlockDominators& dt,
+                               std::vector<std::vector<unsigned>>& frontiers) {
+  size_t n = g.blocks.size();
+  frontiers.assign(n, {});
+
+  for (unsigned b = 0; b < n; b++) {
+    if (!g.reachable(b) || g.preds[b].size() < 2) continue;
+
+    for (unsigned pred : g.preds[b]) {
+      if (!g.reachable(pred)) continue;
+
+      for (int runner = pred; runner != dt.idom[b]; runner = dt.idom[runner]) {
+        std::vector<unsigned>& df = frontiers[runner];
+        if (df.empty() || df.back() != b) df.push_back(b);
+        if (dt.idom[runner] == BlockDominators::None) break;
+      }
+    }
+  }
+}
+
+/*
+ * Finds back edges (latch -> header where the header dominates the latch),
+ * collects each loop's body by walking predecessors back from its latches,
+ * then nests loops by body size.
+ */
+void computeLoops(const BlockGraph& g, const BlockDominators& dt, LoopForest& forest) {
+  size_t n = g.blocks.size();
+  forest.loops.clear();
+  forest.loopOf.assign(n, -1);
+  forest.topLevel.clear();
+
+  std::vector<int> inLoop(n, -1);  // id of the loop whose body is being collected
+
+  for (unsigned p = 0; p < g.numReachable; p++) {
+    unsigned h = g.order[p];
+
+    NaturalLoop loop;
+    loop.header = h;
+    for (unsigned pred : g.preds[h]) {
+      if (dt.dominates(h, pred)) loop.latches.push_back(pred);
+    }
+    if (loop.latches.empty()) continue;
+
+    int id = forest.loops.size();
+    std::sort(loop.latches.begin(), loop.latches.end());
+    loop.latches.erase(std::unique(loop.latches.begin(), loop.latches.end()), loop.latches.end());
+
+    // Body: the header plus everything that reaches a latch without passing it
+    inLoop[h] = id;
+    loop.blocks.push_back(h);
+    std::vector<unsigned> worklist;
+    for (unsigned latch : loop.latches) {
+      if (inLoop[latch] == id) continue;
+      inLoop[latch] = id;
+      loop.blocks.push_back(latch);
+      worklist.push_back(latch);
+    }
+    while (!worklist.empty()) {
+      unsigned b = worklist.back();
+      worklist.pop_back();
+      for (unsigned pred : g.preds[b]) {
+        if (!g.reachable(pred) || inLoop[pred] == id) continue;
+        inLoop[pred] = id;
+        loop.blocks.push_back(pred);
+        worklist.push_back(pred);
+      }
+    }
+    std::sort(loop.blocks.begin(), loop.blocks.end());
+
+    for (unsigned b : loop.blocks) {
+      for (unsigned s : g.succs[b]) {
+        if (inLoop[s] != id) loop.exits.push_back(s);
+      }
+    }
+    std::sort(loop.exits.begin(), loop.exits.end());
+    loop.exits.erase(std::unique(loop.exits.begin(), loop.exits.end()), loop.exits.end());
+
+    // Preheader: the only reachable outside predecessor, with the header as
+    // its only edge
+    int outside = -1;
+    bool single = true;
+    for (unsigned pred : g.preds[h]) {
+      if (inLoop[pred] == id || !g.reachable(pred)) continue;
+      if (outside >= 0 && outside != (int)pred) single = false;
+      outside = pred;
+    }
+    if (outside >= 0 && single && g.succs[outside].size() == 1) loop.preheader = outside;
+
+    forest.loops.push_back(loop);
+  }
+
+  // Larger loops first: a loop's enclosing loops are strictly larger, so the
+  // last one written into loopOf[header] is its parent
+  std::vector<unsigned> bySize(forest.loops.size());
+  for (unsigned i = 0; i < bySize.size(); i++) bySize[i] = i;
+  std::stable_sort(bySize.begin(), bySize.end(), [&](unsigned a, unsigned b) {
+    return forest.loops[a].blocks.size() > forest.loops[b].blocks.size();
+  });
+
+  for (unsigned id : bySize) {
+    NaturalLoop& loop = forest.loops[id];
+    loop.parent = forest.loopOf[loop.header];
+    loop.depth = loop.parent < 0 ? 1 : forest.loops[loop.parent].depth + 1;
+    for (unsigned b : loop.blocks) forest.loopOf[b] = id;
+  }
+
+  for (unsigned id = 0; id < forest.loops.size(); id++) {
+    int parent = forest.loops[id].parent;
+    if (parent < 0) forest.topLevel.push_back(id);
+    else forest.loops[parent].children.push_back(id);
+  }
+}
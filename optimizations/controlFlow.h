@@ -0,0 +1,86 @@
+/*
+ * controlFlow.h
+ *
+ * Control-flow analyses over the LLVM C API: a numbered CFG with reverse
+ * postorder, the dominator tree (Cooper, Harvey and Kennedy, "A Simple, Fast
+ * Dominance Algorithm"), dominance frontiers and the natural loop forest.
+ *
+ * Blocks are referred to by their number in BlockGraph (layout position).
+ * Passes normally get these through analysesFor() rather than computing them.
+ * Type names here and in dataflow.h (BlockDominators, NaturalLoop, FactSet)
+ * differ from LLVM's, so passes can use namespace llvm alongside them.
+ */
+
+#ifndef CONTROL_FLOW_H
+#define CONTROL_FLOW_H
+
+#include <unordered_map>
+#include <vector>
+
+#include <llvm-c/Core.h>
+
+/*
+ * Control flow graph with blocks numbered by layout position.
+ */
+struct BlockGraph {
+  std::vector<LLVMBasicBlockRef> blocks;                  // number -> block
+  std::unordered_map<LLVMBasicBlockRef, unsigned> number; // block -> number
+  std::vector<std::vector<unsigned>> preds;
+  std::vector<std::vector<unsigned>> succs;
+
+  // Reachable blocks in reverse postorder, then unreachable ones in layout order
+  std::vector<unsigned> order;
+  std::vector<unsigned> rpoIndex;  // block number -> position in order
+  unsigned numReachable = 0;
+
+  bool reachable(unsigned b) const { return rpoIndex[b] < numReachable; }
+};
+
+struct BlockDominators {
+  enum { None = -1 };
+
+  std::vector<int> idom;  // immediate dominator; None for the entry and unreachable blocks
+  std::vector<std::vector<unsigned>> children;
+
+  /* True if a dominates b (every block dominates itself). Unreachable
+   * blocks dominate nothing and are dominated by nothing. */
+  bool dominates(unsigned a, unsigned b) const {
+    return enter[a] <= enter[b] && leave[b] <= leave[a] && leave[b] != 0;
+  }
+
+  // DFS numbers over the tree, used for constant-time dominates(); 0 when unreachable
+  std::vector<unsigned> enter;
+  std::vector<unsigned> leave;
+};
+
+struct NaturalLoop {
+  unsigned header;
+  std::vector<unsigned> blocks;    // includes the header and nested loops' blocks
+  std::vector<unsigned> latches;   // blocks with a back edge to the header
+  std::vector<unsigned> exits;     // blocks outside the loop entered from inside
+  int preheader = -1;              // sole outside predecessor, whose only edge is to the header
+  int parent = -1;                 // enclosing loop, -1 for a top-level loop
+  std::vector<unsigned> children;  // loops nested directly inside
+  unsigned depth = 1;
+};
+
+struct LoopForest {
+  std::vector<NaturalLoop> loops;
+  std::vector<int> loopOf;           // block number -> innermost loop, -1 if none
+  std::vector<unsigned> topLevel;
+};
+
+/* Numbers blocks, records terminator edges and computes reverse postorder. */
+void buildBlockGraph(const std::vector<LLVMBasicBlockRef>& blocks, BlockGraph& g);
+
+/* Dominator tree of the reachable blocks. */
+void computeDominators(const BlockGraph& g, BlockDominators& dt);
+
+/* DF[b]: blocks where b's dominance ends, in increasing block number. */
+void computeDominanceFrontiers(const BlockGraph& g, const BlockDominators& dt,
+                               std::vector<std::vector<unsigned>>& frontiers);
+
+/* Natural loops; back edges to the same header form one loop. */
+void computeLoops(const BlockGraph& g, const BlockDominators& dt, LoopForest& forest);
+
+#endif
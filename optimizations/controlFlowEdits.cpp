@@ -0,0 +1,87 @@
+/*
+ * controlFlowEdits.cpp
+ *
+ * Branch folding and block deletion. See controlFlowEdits.h.
+ */
+
+#include <vector>
+
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/Constants.h>
+
+#include "controlFlowEdits.h"
+#include "passManager.h"
+
+using namespace llvm;
+
+bool foldConstantBranch(BranchInst* br) {
+  if (br->isUnconditional()) return false;
+
+  ConstantInt* cond = dyn_cast<ConstantInt>(br->getCondition());
+  if (!cond) return false;
+
+  BasicBlock* bb = br->getParent();
+  BasicBlock* taken = br->getSuccessor(cond->isZero() ? 1 : 0);
+  BasicBlock* dropped = br->getSuccessor(cond->isZero() ? 0 : 1);
+
+  // Removes one operand per phi, so with both edges to one block one is left
+  for (PHINode& phi : dropped->phis()) phi.removeIncomingValue(bb, false);
+
+  BranchInst::Create(taken, br);
+  br->eraseFromParent();
+  passCounters.branchesFolded++;
+  return true;
+}
+
+unsigned long long deleteBlocks(ArrayRef<BasicBlock*> dead) {
+  DenseSet<BasicBlock*> deadSet(dead.begin(), dead.end());
+  unsigned long long deleted = 0;
+
+  for (BasicBlock* bb : dead) {
+    for (BasicBlock* succ : successors(bb)) {
+      if (deadSet.count(succ)) continue;
+      for (PHINode& phi : succ->phis()) {
+        while (phi.getBasicBlockIndex(bb) >= 0) phi.removeIncomingValue(bb, false);
+      }
+    }
+
+    for (Instruction& I : *bb) {
+      if (!I.use_empty()) I.replaceAllUsesWith(UndefValue::get(I.getType()));
+      deleted++;
+    }
+  }
+
+  // Dead blocks may branch to each other, so cut every reference first
+  for (BasicBlock* bb : dead) bb->dropAllReferences();
+  for (BasicBlock* bb : dead) bb->eraseFromParent();
+
+  passCounters.blocksDeleted += dead.size();
+  passCounters.instructionsDeleted += deleted;
+  return deleted;
+}
+
+unsigned long long deleteUnreachableBlocks(Function& function) {
+  if (function.empty()) return 0;
+
+  DenseSet<BasicBlock*> reached;
+  SmallVector<BasicBlock*, 32> worklist;
+  reached.insert(&function.getEntryBlock());
+  worklist.push_back(&function.getEntryBlock());
+
+  while (!worklist.empty()) {
+    BasicBlock* bb = worklist.pop_back_val();
+    for (BasicBlock* succ : successors(bb)) {
+      if (reached.insert(succ).second) worklist.push_back(succ);
+    }
+  }
+
+  if (reached.size() == function.size()) return 0;
+
+  std::vector<BasicBlock*> dead;
+  for (BasicBlock& bb : function) {
+    if (!reached.count(&bb)) dead.push_back(&bb);
+  }
+  return deleteBlocks(dead);
+}
@@ -0,0 +1,31 @@
+/*
+ * controlFlowEdits.h
+ *
+ * CFG rewrites shared by the passes that fold branches or delete blocks.
+ * They keep phis consistent with the edges that remain and bump the
+ * branchesFolded and blocksDeleted counters, which tell the pass manager
+ * that the cached CFG analyses are stale.
+ */
+
+#ifndef CONTROL_FLOW_EDITS_H
+#define CONTROL_FLOW_EDITS_H
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+
+/* Replaces `br i1 <constant>` by a branch to the successor it takes and
+ * drops the phi operands of the other edge. Returns false for any other
+ * branch. */
+bool foldConstantBranch(llvm::BranchInst* br);
+
+/* Deletes `dead` (never the entry block). Phis in the remaining blocks lose
+ * the operands for edges from `dead`, and remaining uses of the deleted
+ * instructions become undef. Returns the number of instructions deleted. */
+unsigned long long deleteBlocks(llvm::ArrayRef<llvm::BasicBlock*> dead);
+
+/* Deletes the blocks that cannot be reached from the entry block. */
+unsigned long long deleteUnreachableBlocks(llvm::Function& function);
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ * dataflow.h
+ *
+ * Bit-vector dataflow framework. Facts are numbered densely and each block's
+ * set is a FactSet, a bit vector of 64-bit words, so union, intersection and
+ * the transfer function are straight word loops the compiler can vectorize.
+ *
+ * DataflowSolver is templated on direction and meet operator and solves
+ *   forward:  IN[b]  = meet(OUT[p] for preds p),  OUT[b] = GEN[b] | (IN[b]  & ~KILL[b])
+ *   backward: OUT[b] = meet(IN[s] for succs s),   IN[b]  = GEN[b] | (OUT[b] & ~KILL[b])
+ * with a worklist visited in reverse postorder (postorder when backward).
+ */
+
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include <cstdint>
+#include <vector>
+
+#include "controlFlow.h"
+
+class FactSet {
+public:
+  FactSet() = default;
+  explicit FactSet(size_t bits, bool value = false) { resize(bits, value); }
+
+  void resize(size_t bits, bool value = false) {
+    size = bits;
+    words.assign((bits + 63) / 64, value ? ~0ull : 0);
+    clearUnusedBits();
+  }
+
+  size_t bits() const { return size; }
+
+  bool test(size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+  void set(size_t i) { words[i / 64] |= 1ull << (i % 64); }
+  void reset(size_t i) { words[i / 64] &= ~(1ull << (i % 64)); }
+
+  void unionWith(const FactSet& o) {
+    for (size_t w = 0; w < words.size(); w++) words[w] |= o.words[w];
+  }
+
+  void intersectWith(const FactSet& o) {
+    for (size_t w = 0; w < words.size(); w++) words[w] &= o.words[w];
+  }
+
+  void subtract(const FactSet& o) {
+    for (size_t w = 0; w < words.size(); w++) words[w] &= ~o.words[w];
+  }
+
+  /* this = gen | (in & ~kill); returns true if the value changed. */
+  bool assignTransfer(const FactSet& gen, const FactSet& in, const FactSet& kill) {
+    uint64_t diff = 0;
+    for (size_t w = 0; w < words.size(); w++) {
+      uint64_t v = gen.words[w] | (in.words[w] & ~kill.words[w]);
+      diff |= v ^ words[w];
+      words[w] = v;
+    }
+    return diff != 0;
+  }
+
+  bool operator==(const FactSet& o) const { return size == o.size && words == o.words; }
+  bool operator!=(const FactSet& o) const { return !(*this == o); }
+
+  /* Calls f(i) for every set bit, in increasing order. */
+  template <class F>
+  void forEach(F f) const {
+    for (size_t w = 0; w < words.size(); w++) {
+      for (uint64_t bitsLeft = words[w]; bitsLeft != 0; bitsLeft &= bitsLeft - 1) {
+        f(w * 64 + __builtin_ctzll(bitsLeft));
+      }
+    }
+  }
+
+private:
+  void clearUnusedBits() {
+    if (size % 64 != 0) words.back() &= (1ull << (size % 64)) - 1;
+  }
+
+  std::vector<uint64_t> words;
+  size_t size = 0;
+};
+
+enum class DataflowDirection { Forward, Backward };
+
+/* May problems: a fact holds if it holds along some path. */
+struct UnionMeet {
+  static bool top() { return false; }
+  static void meet(FactSet& acc, const FactSet& v) { acc.unionWith(v); }
+};
+
+/* Must problems: a fact holds only if it holds along every path. */
+struct IntersectMeet {
+  static bool top() { return true; }
+  static void meet(FactSet& acc, const FactSet& v) { acc.intersectWith(v); }
+};
+
+template <DataflowDirection Direction, class Meet>
+class DataflowSolver {
+public:
+  /*
+   * Solves the problem over `g` for `bits` facts. Blocks without
+   * predecessors (successors when backward) start from the empty set.
+   * `in` and `out` are indexed by block number. Returns the number of sweeps
+   * over the block order.
+   */
+  static unsigned solve(const BlockGraph& g, size_t bits,
+                    const std::vector<FactSet>& gen,
+                    const std::vector<FactSet>& kill,
+                    std::vector<FactSet>& in,
+                    std::vector<FactSet>& out) {
+    const bool forward = Direction == DataflowDirection::Forward;
+    size_t n = g.blocks.size();
+
+    // "before" is the meet side of a block, "after" the transfer side
+    std::vector<FactSet>& before = forward ? in : out;
+    std::vector<FactSet>& after = forward ? out : in;
+    const std::vector<std::vector<unsigned>>& sources = forward ? g.preds : g.succs;
+    const std::vector<std::vector<unsigned>>& targets = forward ? g.succs : g.preds;
+
+    before.assign(n, FactSet(bits));
+    after.assign(n, FactSet(bits, Meet::top()));
+
+    // Backward problems walk the order reversed
+    std::vector<unsigned> visit(g.order.begin(), g.order.end());
+    if (!forward) visit.assign(g.order.rbegin(), g.order.rend());
+
+    // Sweep pending blocks in order; a change re-queues the blocks it feeds
+    std::vector<bool> pending(n, true);
+    size_t remaining = n;
+    unsigned sweeps = 0;
+    while (remaining > 0) {
+      sweeps++;
+      for (unsigned p = 0; p < n && remaining > 0; p++) {
+        unsigned b = visit[p];
+        if (!pending[b]) continue;
+        pending[b] = false;
+        remaining--;
+
+        FactSet& meet = before[b];
+        if (sources[b].empty()) {
+          meet.resize(bits);
+        } else {
+          meet = after[sources[b][0]];
+          for (size_t i = 1; i < sources[b].size(); i++) Meet::meet(meet, after[sources[b][i]]);
+        }
+
+        if (!after[b].assignTransfer(gen[b], meet, kill[b])) continue;
+        for (unsigned t : targets[b]) {
+          if (!pending[t]) {
+            pending[t] = true;
+            remaining++;
+          }
+        }
+      }
+    }
+    return sweeps;
+  }
+};
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * deadStoreElimination.cpp
+ *
+ * Global dead store elimination ("dse" in pipelines). dce keeps every store,
+ * since a store is a side effect; this pass removes the ones no load can see.
+ * It works on allocas that are only loaded and stored (the local slots of
+ * StoreIndex), which nothing outside the function can read:
+ *  1) solves liveness of the slots backward over the CFG: a slot is live at
+ *     a point if some path from there loads it before storing to it. Every
+ *     slot is dead when the function returns
+ *  2) deletes the stores to a slot that is dead right after them, such as
+ *     one overwritten before any load or one to a variable never read again
+ *  3) deletes allocas without any use left
+ */
+
+#include <vector>
+
+#include <llvm-c/Core.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Instructions.h>
+
+#include "analysisManager.h"
+#include "passManager.h"
+
+using namespace llvm;
+
+/* Address number of the local slot `pointer`, or -1 if it is not one. */
+static int localSlot(const StoreIndex& numbering, Value* pointer) {
+  auto address = numbering.addresses.find(wrap(pointer));
+  if (address == numbering.addresses.end() || numbering.clobberedFact[address->second] >= 0) return -1;
+  return address->second;
+}
+
+/*
+ * GEN holds the slots a block loads before storing to them; KILL the slots
+ * it stores to. Bits are StoreIndex address numbers.
+ */
+static void computeUseDef(const BlockGraph& g, const StoreIndex& numbering,
+                          std::vector<FactSet>& gen, std::vector<FactSet>& kill) {
+  size_t bits = numbering.storesTo.size();
+  gen.assign(g.blocks.size(), FactSet(bits));
+  kill.assign(g.blocks.size(), FactSet(bits));
+
+  for (unsigned b = 0; b < g.blocks.size(); b++) {
+    for (Instruction& I : *unwrap(g.blocks[b])) {
+      if (LoadInst* load = dyn_cast<LoadInst>(&I)) {
+        int slot = localSlot(numbering, load->getPointerOperand());
+        if (slot >= 0 && !kill[b].test(slot)) gen[b].set(slot);
+      } else if (StoreInst* store = dyn_cast<StoreInst>(&I)) {
+        int slot = localSlot(numbering, store->getPointerOperand());
+        if (slot >= 0) kill[b].set(slot);
+      }
+    }
+  }
+}
+
+/*
+ * Dead Store Elimination
+ * Deletes stores to local slots that no load can see, then the allocas
+ * left unused; see the top of this file.
+ */
+bool deadStoreElimination(LLVMValueRef function) {
+  FunctionAnalyses& analyses = analysesFor(function);
+  const BlockGraph& g = analyses.cfg();
+  const StoreIndex& numbering = analyses.stores();
+
+  bool anyLocal = false;
+  for (int fact : numbering.clobberedFact) anyLocal |= fact < 0;
+  if (!anyLocal) return false;
+
+  std::vector<FactSet> gen, kill, in, out;
+  computeUseDef(g, numbering, gen, kill);
+  passCounters.dataflowSweeps += DataflowSolver<DataflowDirection::Backward, UnionMeet>::solve(
+      g, numbering.storesTo.size(), gen, kill, in, out);
+
+  // Walk each block backward from its OUT set
+  SmallVector<StoreInst*, 16> dead;
+  for (unsigned b = 0; b < g.blocks.size(); b++) {
+    FactSet live = out[b];
+    BasicBlock* bb = unwrap(g.blocks[b]);
+
+    for (auto it = bb->rbegin(); it != bb->rend(); ++it) {
+      if (LoadInst* load = dyn_cast<LoadInst>(&*it)) {
+        int slot = localSlot(numbering, load->getPointerOperand());
+        if (slot >= 0) live.set(slot);
+        continue;
+      }
+
+      StoreInst* store = dyn_cast<StoreInst>(&*it);
+      if (!store) continue;
+      int slot = localSlot(numbering, store->getPointerOperand());
+      if (slot < 0) continue;
+
+      if (!live.test(slot) && !store->isVolatile()) dead.push_back(store);
+      live.reset(slot);
+    }
+  }
+
+  for (StoreInst* store : dead) store->eraseFromParent();
+  unsigned long long deleted = dead.size();
+
+  // Allocas nothing uses any more, including slots that were never read
+  for (unsigned b = 0; b < g.blocks.size(); b++) {
+    BasicBlock* bb = unwrap(g.blocks[b]);
+    for (auto it = bb->begin(); it != bb->end();) {
+      AllocaInst* alloca = dyn_cast<AllocaInst>(&*it++);
+      if (!alloca || !alloca->use_empty()) continue;
+      alloca->eraseFromParent();
+      deleted++;
+    }
+  }
+
+  passCounters.instructionsDeleted += deleted;
+  return deleted > 0;
+}
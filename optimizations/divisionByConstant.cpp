@@ -0,0 +1,192 @@
+/*
+ * divisionByConstant.cpp
+ *
+ * Lowers signed division by a constant ("divconst" in pipelines). The IR
+ * builder emits sdiv for every '/', and a hardware divide takes tens of
+ * cycles where a multiply and a few shifts take a handful. For x / d with
+ * d a non-zero constant:
+ *  - d = 1 and d = -1 become x and 0 - x
+ *  - d = +-2^k shifts with rounding towards zero: negative x is first
+ *    biased by 2^k - 1, taken from its sign bits
+ *  - any other d multiplies by a "magic" constant M and keeps the high half
+ *    of the double-width product, then corrects and shifts (Hacker's
+ *    Delight, chapter 10): q = mulhs(x, M) (+x if d > 0 and M < 0, -x if
+ *    d < 0 and M > 0), q >>= s, and q += 1 if q is negative
+ * srem computes x - (x / d) * d from the same quotient sequence, so gvn
+ * shares it between x / d and x % d.
+ */
+
+#include <llvm-c/Core.h>
+#include <llvm/ADT/APInt.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Instructions.h>
+
+#include "passManager.h"
+
+using namespace llvm;
+
+/* Multiplier and shift for signed division by `d`, which is not 0, 1, -1 or +-2^k. */
+struct SignedMagic {
+  APInt multiplier;
+  unsigned shift;
+};
+
+/*
+ * Finds the smallest p >= W for which 2^p / |d|, rounded up, is a
+ * multiplier exact for every W-bit dividend; all arithmetic is on W-bit
+ * unsigned values, as in Hacker's Delight figure 10-1.
+ */
+static SignedMagic signedMagic(const APInt& d) {
+  unsigned width = d.getBitWidth();
+  APInt signedMin = APInt::getSignedMinValue(width);
+  APInt ad = d.abs();
+  APInt t = signedMin + d.lshr(width - 1);
+  APInt anc = t - 1 - t.urem(ad);  // |nc|, the largest dividend with remainder |d| - 1
+
+  unsigned p = width - 1;
+  APInt q1 = signedMin.udiv(anc);  // 2^p / |nc| and its remainder
+  APInt r1 = signedMin - q1 * anc;
+  APInt q2 = signedMin.udiv(ad);   // 2^p / |d| and its remainder
+  APInt r2 = signedMin - q2 * ad;
+  APInt delta;
+
+  do {
+    p++;
+    q1 <<= 1;
+    r1 <<= 1;
+    if (r1.uge(anc)) {
+      q1 += 1;
+      r1 -= anc;
+    }
+    q2 <<= 1;
+    r2 <<= 1;
+    if (r2.uge(ad)) {
+      q2 += 1;
+      r2 -= ad;
+    }
+    delta = ad - r2;
+  } while (q1.ult(delta) || (q1 == delta && r1.isZero()));
+
+  SignedMagic magic;
+  magic.multiplier = q2 + 1;
+  if (d.isNegative()) magic.multiplier = -magic.multiplier;
+  magic.shift = p - width;
+  return magic;
+}
+
+/* Emits the quotient x / d before `at`; see the top of this file. */
+static Value* emitQuotient(Value* x, const APInt& d, Instruction* at) {
+  IntegerType* type = cast<IntegerType>(x->getType());
+  unsigned width = type->getBitWidth();
+  auto emit = [&](Instruction::BinaryOps op, Value* a, Value* b, const Twine& name) -> Value* {
+    return BinaryOperator::Create(op, a, b, name, at);
+  };
+  auto constant = [&](const APInt& v) { return ConstantInt::get(type, v); };
+  auto amount = [&](unsigned v) { return ConstantInt::get(type, v); };
+
+  if (d.isOne()) return x;
+  if (d.isAllOnes()) return emit(Instruction::Sub, constant(APInt(width, 0)), x, "div.neg");
+
+  APInt ad = d.abs();
+  if (ad.isPowerOf2()) {
+    unsigned k = ad.logBase2();
+
+    // All ones for negative x, shifted down to the low k bits
+    Value* sign = k > 1 ? emit(Instruction::AShr, x, amount(k - 1), "div.sign") : x;
+    Value* bias = emit(Instruction::LShr, sign, amount(width - k), "div.bias");
+    Value* biased = emit(Instruction::Add, x, bias, "div.biased");
+    Value* q = emit(Instruction::AShr, biased, amount(k), "div.q");
+    return d.isNegative() ? emit(Instruction::Sub, constant(APInt(width, 0)), q, "div.neg") : q;
+  }
+
+  SignedMagic magic = signedMagic(d);
+  IntegerType* wide = IntegerType::get(type->getContext(), width * 2);
+
+  // High half of the double-width product
+  Value* wideX = new SExtInst(x, wide, "div.wide", at);
+  Value* product = emit(Instruction::Mul, wideX, ConstantInt::get(wide, magic.multiplier.sext(width * 2)),
+                        "div.product");
+  Value* high = emit(Instruction::AShr, product, ConstantInt::get(wide, width), "div.high");
+  Value* q = new TruncInst(high, type, "div.mulhs", at);
+
+  if (d.isStrictlyPositive() && magic.multiplier.isNegative()) {
+    q = emit(Instruction::Add, q, x, "div.fix");
+  } else if (d.isNegative() && magic.multiplier.isStrictlyPositive()) {
+    q = emit(Instruction::Sub, q, x, "div.fix");
+  }
+  if (magic.shift > 0) q = emit(Instruction::AShr, q, amount(magic.shift), "div.shift");
+
+  // Round towards zero: add one to a negative quotient
+  Value* negative = emit(Instruction::LShr, q, amount(width - 1), "div.round");
+  return emit(Instruction::Add, q, negative, "div.q");
+}
+
+/* Emits x % d before `at` for a power-of-two |d|: x minus x rounded towards zero. */
+static Value* emitPowerOfTwoRemainder(Value* x, const APInt& d, Instruction* at) {
+  IntegerType* type = cast<IntegerType>(x->getType());
+  unsigned width = type->getBitWidth();
+  unsigned k = d.abs().logBase2();
+
+  auto emit = [&](Instruction::BinaryOps op, Value* a, Value* b, const Twine& name) -> Value* {
+    return BinaryOperator::Create(op, a, b, name, at);
+  };
+
+  Value* sign = k > 1 ? emit(Instruction::AShr, x, ConstantInt::get(type, k - 1), "rem.sign") : x;
+  Value* bias = emit(Instruction::LShr, sign, ConstantInt::get(type, width - k), "rem.bias");
+  Value* biased = emit(Instruction::Add, x, bias, "rem.biased");
+  Value* rounded = emit(Instruction::And, biased, ConstantInt::get(type, APInt::getHighBitsSet(width, width - k)),
+                        "rem.rounded");
+  return emit(Instruction::Sub, x, rounded, "rem");
+}
+
+/*
+ * Lower division by constant
+ * Rewrites sdiv and srem whose divisor is a non-zero constant; see the top
+ * of this file. Types wider than 64 bits are left alone, since the
+ * multiply-high would need a 256-bit product.
+ */
+bool lowerConstantDivision(LLVMValueRef function) {
+  SmallVector<BinaryOperator*, 8> divisions;
+  for (BasicBlock& bb : *unwrap<Function>(function)) {
+    for (Instruction& I : bb) {
+      BinaryOperator* bo = dyn_cast<BinaryOperator>(&I);
+      if (!bo || (bo->getOpcode() != Instruction::SDiv && bo->getOpcode() != Instruction::SRem)) continue;
+
+      IntegerType* type = dyn_cast<IntegerType>(bo->getType());
+      ConstantInt* d = dyn_cast<ConstantInt>(bo->getOperand(1));
+      if (!type || type->getBitWidth() < 2 || type->getBitWidth() > 64 || !d || d->isZero()) continue;
+      if (isa<Constant>(bo->getOperand(0))) continue;  // cf folds these
+      divisions.push_back(bo);
+    }
+  }
+
+  for (BinaryOperator* I : divisions) {
+    Value* x = I->getOperand(0);
+    const APInt& d = cast<ConstantInt>(I->getOperand(1))->getValue();
+    Value* result;
+
+    if (I->getOpcode() == Instruction::SDiv) {
+      result = emitQuotient(x, d, I);
+    } else if (d.isOne() || d.isAllOnes()) {
+      result = ConstantInt::get(I->getType(), 0);
+    } else if (d.abs().isPowerOf2()) {
+      result = emitPowerOfTwoRemainder(x, d, I);
+    } else {
+      Value* q = emitQuotient(x, d, I);
+      Value* product = BinaryOperator::Create(Instruction::Mul, q, I->getOperand(1), "rem.product", I);
+      result = BinaryOperator::Create(Instruction::Sub, x, product, "rem", I);
+    }
+
+    if (result != x && isa<Instruction>(result)) result->takeName(I);
+    I->replaceAllUsesWith(result);
+    I->eraseFromParent();
+    passCounters.instructionsDeleted++;
+  }
+
+  return !divisions.empty();
+}
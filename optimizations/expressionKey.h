@@ -0,0 +1,95 @@
+/*
+ * expressionKey.h
+ *
+ * Value-numbering keys shared by cse (one block at a time) and gvn (across
+ * the dominator tree). Two instructions with equal keys compute the same
+ * value.
+ */
+
+#ifndef EXPRESSION_KEY_H
+#define EXPRESSION_KEY_H
+
+#include <functional>
+#include <utility>
+
+#include <llvm/ADT/Hashing.h>
+#include <llvm/IR/Instructions.h>
+
+/*
+ * Value-numbering key: opcode, result type, icmp predicate and operands.
+ * Operands of commutative operations are put in a canonical order, and
+ * icmp is keyed on the predicate that has the lower operand first, so
+ * a+b matches b+a and a<b matches b>a. Poison flags (nsw, nuw, exact) are
+ * left out: whoever replaces one instruction with another calls andIRFlags
+ * on the survivor, so it keeps only the flags both had.
+ */
+struct ExprKey {
+  unsigned op = 0;
+  llvm::Type* type = nullptr;
+  unsigned predicate = 0;
+  unsigned numOperands = 0;
+  llvm::Value* operands[3] = {nullptr, nullptr, nullptr};
+};
+
+struct ExprKeyInfo {
+  static ExprKey getEmptyKey() {
+    ExprKey k;
+    k.op = ~0u;
+    return k;
+  }
+
+  static ExprKey getTombstoneKey() {
+    ExprKey k;
+    k.op = ~0u - 1;
+    return k;
+  }
+
+  static unsigned getHashValue(const ExprKey& k) {
+    return llvm::hash_combine(k.op, k.type, k.predicate,
+                              llvm::hash_combine_range(k.operands, k.operands + k.numOperands));
+  }
+
+  static bool isEqual(const ExprKey& a, const ExprKey& b) {
+    if (a.op != b.op || a.type != b.type || a.predicate != b.predicate) return false;
+    if (a.numOperands != b.numOperands) return false;
+    for (unsigned i = 0; i < a.numOperands; i++) {
+      if (a.operands[i] != b.operands[i]) return false;
+    }
+    return true;
+  }
+};
+
+/*
+ * Builds the key for a pure instruction (add sub mul sdiv icmp zext select);
+ * returns false for anything else.
+ */
+inline bool makeExprKey(llvm::Instruction& I, ExprKey& key) {
+  unsigned op = I.getOpcode();
+  switch (op) {
+    case llvm::Instruction::Add: case llvm::Instruction::Sub: case llvm::Instruction::Mul:
+    case llvm::Instruction::SDiv: case llvm::Instruction::ICmp: case llvm::Instruction::ZExt:
+    case llvm::Instruction::Select:
+      break;
+    default:
+      return false;
+  }
+
+  key.op = op;
+  key.type = I.getType();
+  key.numOperands = I.getNumOperands();
+  for (unsigned i = 0; i < key.numOperands; i++) key.operands[i] = I.getOperand(i);
+
+  std::less<llvm::Value*> before;
+  bool swap = before(key.operands[1], key.operands[0]);
+
+  if (llvm::ICmpInst* cmp = llvm::dyn_cast<llvm::ICmpInst>(&I)) {
+    key.predicate = swap ? cmp->getSwappedPredicate() : cmp->getPredicate();
+  } else if (op != llvm::Instruction::Add && op != llvm::Instruction::Mul) {
+    swap = false;
+  }
+
+  if (swap) std::swap(key.operands[0], key.operands[1]);
+  return true;
+}
+
+#endif
@@ -1,299 +1,279 @@
 /*
  * globalOptimizations.cpp
  *
- * Implements global constant propagation using reaching store instructions.
- * Tracks stores with GEN/KILL/IN/OUT per basic block, then replaces loads when
- * all reaching stores write the same constant to the same address.
+ * Implements global constant propagation ("cp") and copy propagation
+ * ("copyprop") using reaching store instructions. Reaching stores
+ * (GEN/KILL/IN/OUT per basic block) come from the analysis cache. cp replaces
+ * a load when all reaching stores write the same constant to the same
+ * address; copyprop forwards whatever value was stored, merging different
+ * stores with phis.
  */
 
+#include <utility>
 #include <vector>
-#include <set>
-#include <unordered_map>
 
 #include <llvm-c/Core.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/ValueHandle.h>
 
-static bool isStore(LLVMValueRef I) {
-  return LLVMGetInstructionOpcode(I) == LLVMStore;
-}
+#include "analysisManager.h"
+#include "passManager.h"
 
-static bool isLoad(LLVMValueRef I) {
-  return LLVMGetInstructionOpcode(I) == LLVMLoad;
-}
+using namespace llvm;
 
-static LLVMValueRef storePointer(LLVMValueRef storeInst) {
-  return LLVMGetOperand(storeInst, 1);
-}
+/*
+ * Constant propagation using store-load reaching stores.
+ * Replaces loads if all reaching stores to the same address store the same constant.
+ */
+bool constantPropagation(LLVMValueRef function) {
+  bool changed = false;
 
-static LLVMValueRef storeValue(LLVMValueRef storeInst) {
-  return LLVMGetOperand(storeInst, 0);
-}
+  // CFG, store numbering and IN sets come from the analysis cache
+  FunctionAnalyses& analyses = analysesFor(function);
+  const BlockGraph& g = analyses.cfg();
+  const StoreIndex& numbering = analyses.stores();
+  const std::vector<FactSet>& in = analyses.reachingStoresIn();
 
-static LLVMValueRef loadPointer(LLVMValueRef loadInst) {
-  return LLVMGetOperand(loadInst, 0);
-}
+  SmallVector<StoreInst*, 8> reachingStores;
+  SmallVector<LoadInst*, 16> loadsToDelete;
 
-static bool isConstantStore(LLVMValueRef storeInst) {
-  LLVMValueRef v = storeValue(storeInst);
-  return LLVMIsAConstantInt(v) != nullptr;
-}
+  // Walk each block and replace loads using running reaching set R
+  for (unsigned b = 0; b < g.blocks.size(); b++) {
+    FactSet R = in[b];
+    loadsToDelete.clear();
 
-static long long constantStoreValue(LLVMValueRef storeInst) {
-  return LLVMConstIntGetSExtValue(storeValue(storeInst));
-}
+    for (Instruction& I : *unwrap(g.blocks[b])) {
 
-static void removeStoresToPointer(std::set<LLVMValueRef>& storeSet, LLVMValueRef ptr) {
-  for (auto it = storeSet.begin(); it != storeSet.end(); ) {
-    LLVMValueRef s = *it;
-    if (storePointer(s) == ptr) it = storeSet.erase(it);
-    else ++it;
-  }
-}
+      LoadInst* load = dyn_cast<LoadInst>(&I);
+      if (!load) {
+        numbering.step(wrap(&I), R);
+        continue;
+      }
 
-static std::set<LLVMValueRef> setUnion(const std::set<LLVMValueRef>& a,
-                                       const std::set<LLVMValueRef>& b) {
-  std::set<LLVMValueRef> out = a;
-  out.insert(b.begin(), b.end());
-  return out;
-}
+      // A clobbered address may hold a value none of the stores wrote
+      auto address = numbering.addresses.find(wrap(load->getPointerOperand()));
+      if (address == numbering.addresses.end() || numbering.clobbered(address->second, R)) continue;
 
-static std::set<LLVMValueRef> setDifference(const std::set<LLVMValueRef>& a,
-                                            const std::set<LLVMValueRef>& b) {
-  std::set<LLVMValueRef> out;
-  for (LLVMValueRef x : a) {
-    if (b.find(x) == b.end()) out.insert(x);
-  }
-  return out;
-}
+      // Collect reaching stores to this same pointer
+      reachingStores.clear();
+      for (unsigned s : numbering.storesTo[address->second]) {
+        if (R.test(s)) reachingStores.push_back(unwrap<StoreInst>(numbering.stores[s]));
+      }
 
-static bool setsEqual(const std::set<LLVMValueRef>& a, const std::set<LLVMValueRef>& b) {
-  if (a.size() != b.size()) return false;
-  auto itA = a.begin();
-  auto itB = b.begin();
-  while (itA != a.end()) {
-    if (*itA != *itB) return false;
-    ++itA; ++itB;
-  }
-  return true;
-}
+      if (reachingStores.empty()) continue;
 
-/*
- * Builds predecessor lists for each basic block by scanning terminator successors.
- */
-static std::unordered_map<LLVMBasicBlockRef, std::vector<LLVMBasicBlockRef>>
-buildPredecessors(LLVMValueRef function, const std::vector<LLVMBasicBlockRef>& blocks) {
+      // Check all reaching stores are constant stores with the same constant
+      bool ok = true;
+      long long val = 0;
 
-  std::unordered_map<LLVMBasicBlockRef, std::vector<LLVMBasicBlockRef>> preds;
+      for (size_t idx = 0; idx < reachingStores.size(); idx++) {
+        ConstantInt* c = dyn_cast<ConstantInt>(reachingStores[idx]->getValueOperand());
 
-  for (LLVMBasicBlockRef b : blocks) {
-    preds[b] = {};
-  }
+        if (!c) {
+          ok = false;
+          break;
+        }
 
-  for (LLVMBasicBlockRef b : blocks) {
-    LLVMValueRef term = LLVMGetBasicBlockTerminator(b);
-    if (!term) continue;
+        long long sVal = c->getSExtValue();
+        if (idx == 0) val = sVal;
+        else if (sVal != val) {
+          ok = false;
+          break;
+        }
+      }
+
+      if (!ok) continue;
 
-    unsigned numSucc = LLVMGetNumSuccessors(term);
-    for (unsigned i = 0; i < numSucc; i++) {
-      LLVMBasicBlockRef s = LLVMGetSuccessor(term, i);
-      preds[s].push_back(b);
+      // Replace load with constant and mark for deletion
+      load->replaceAllUsesWith(ConstantInt::get(load->getType(), (unsigned long long)val, true));
+      loadsToDelete.push_back(load);
+      passCounters.loadsReplaced++;
+      changed = true;
     }
+
+    // Delete marked loads after traversal
+    for (LoadInst* l : loadsToDelete) {
+      l->eraseFromParent();
+    }
+    passCounters.instructionsDeleted += loadsToDelete.size();
   }
 
-  return preds;
+  return changed;
 }
 
 /*
- * Computes GEN and KILL sets for all basic blocks in the function.
+ * Builds the value of one address on demand for copy propagation: the value
+ * at a point is the one stored by the nearest store to the address before
+ * it, found by walking back through predecessors. A block with several
+ * predecessors gets a phi merging the value at the end of each. Values on
+ * block entry are kept, so later loads of the same address reuse the phis.
  */
-static void computeGenKill(
-    LLVMValueRef function,
-    const std::vector<LLVMBasicBlockRef>& blocks,
-    const std::set<LLVMValueRef>& allStores,
-    std::unordered_map<LLVMBasicBlockRef, std::set<LLVMValueRef>>& gen,
-    std::unordered_map<LLVMBasicBlockRef, std::set<LLVMValueRef>>& kill) {
-
-  // GEN: last store per address within the block
-  for (LLVMBasicBlockRef b : blocks) {
-    std::set<LLVMValueRef> genSet;
-
-    for (LLVMValueRef I = LLVMGetFirstInstruction(b);
-         I != nullptr;
-         I = LLVMGetNextInstruction(I)) {
-
-      if (!isStore(I)) continue;
-
-      LLVMValueRef ptr = storePointer(I);
-      removeStoresToPointer(genSet, ptr);
-      genSet.insert(I);
-    }
-
-    gen[b] = genSet;
-  }
-
-  // KILL: for each store in B, kill all other stores to same address in function
-  for (LLVMBasicBlockRef b : blocks) {
-    std::set<LLVMValueRef> killSet;
+struct ForwardedValues {
+  const BlockGraph& g;
+  DenseMap<std::pair<Value*, BasicBlock*>, WeakTrackingVH> atEntry;
+  std::vector<PHINode*> phis;
 
-    for (LLVMValueRef I = LLVMGetFirstInstruction(b);
-         I != nullptr;
-         I = LLVMGetNextInstruction(I)) {
+  explicit ForwardedValues(const BlockGraph& graph) : g(graph) {}
 
-      if (!isStore(I)) continue;
+  bool reachable(BasicBlock* bb) const { return g.reachable(g.number.at(wrap(bb))); }
 
-      LLVMValueRef ptr = storePointer(I);
-      for (LLVMValueRef s : allStores) {
-        if (s == I) continue;
-        if (storePointer(s) == ptr) killSet.insert(s);
-      }
+  /* Value of the last store to `pointer` before `end` in its block, or nullptr. */
+  static Value* storedBefore(Value* pointer, BasicBlock* bb, BasicBlock::iterator end) {
+    while (end != bb->begin()) {
+      StoreInst* store = dyn_cast<StoreInst>(&*--end);
+      if (store && store->getPointerOperand() == pointer) return store->getValueOperand();
     }
-
-    kill[b] = killSet;
+    return nullptr;
   }
-}
 
-/*
- * Computes IN and OUT sets for all basic blocks.
- */
-static void computeInOut(
-    const std::vector<LLVMBasicBlockRef>& blocks,
-    const std::unordered_map<LLVMBasicBlockRef, std::vector<LLVMBasicBlockRef>>& preds,
-    const std::unordered_map<LLVMBasicBlockRef, std::set<LLVMValueRef>>& gen,
-    const std::unordered_map<LLVMBasicBlockRef, std::set<LLVMValueRef>>& kill,
-    std::unordered_map<LLVMBasicBlockRef, std::set<LLVMValueRef>>& in,
-    std::unordered_map<LLVMBasicBlockRef, std::set<LLVMValueRef>>& out) {
-
-  // Init IN empty, OUT = GEN
-  for (LLVMBasicBlockRef b : blocks) {
-    in[b] = {};
-    out[b] = gen.at(b);
+  Value* atEnd(Value* pointer, Type* type, BasicBlock* bb) {
+    if (Value* v = storedBefore(pointer, bb, bb->end())) return v;
+    return entryValue(pointer, type, bb);
   }
 
-  // Iterative fixpoint
-  while (true) {
-    bool changed = false;
+  /*
+   * Value of `pointer`, read as `type`, on entry to `bb`. Blocks with one predecessor take its
+   * value at the end; the walk follows such chains iteratively and only
+   * recurses where it creates a phi, which is recorded first so loops stop
+   * at it.
+   */
+  Value* entryValue(Value* pointer, Type* type, BasicBlock* bb) {
+    SmallVector<BasicBlock*, 8> chain;
+    Value* v = nullptr;
+
+    while (true) {
+      auto known = atEntry.find({pointer, bb});
+      if (known != atEntry.end()) {
+        v = known->second;
+        break;
+      }
 
-    for (LLVMBasicBlockRef b : blocks) {
-      std::set<LLVMValueRef> newIn;
+      SmallVector<BasicBlock*, 4> preds;
+      for (BasicBlock* pred : predecessors(bb)) {
+        if (reachable(pred)) preds.push_back(pred);
+      }
 
-      // IN[B] = union of OUT[pred]
-      auto itPreds = preds.find(b);
-      if (itPreds != preds.end()) {
-        for (LLVMBasicBlockRef p : itPreds->second) {
-          newIn = setUnion(newIn, out[p]);
-        }
+      // Nothing stored yet on entry to the function
+      if (preds.empty()) {
+        v = UndefValue::get(type);
+        atEntry[{pointer, bb}] = v;
+        break;
       }
 
-      // OUT[B] = GEN[B] union (IN[B] - KILL[B])
-      std::set<LLVMValueRef> newOut =
-          setUnion(gen.at(b), setDifference(newIn, kill.at(b)));
+      if (preds.size() == 1) {
+        chain.push_back(bb);
+        v = storedBefore(pointer, preds[0], preds[0]->end());
+        if (v) break;
+        bb = preds[0];
+        continue;
+      }
 
-      if (!setsEqual(newIn, in[b]) || !setsEqual(newOut, out[b])) {
-        in[b] = newIn;
-        out[b] = newOut;
-        changed = true;
+      // One operand per edge, from every predecessor including unreachable ones
+      PHINode* phi = PHINode::Create(type, preds.size(), pointer->getName() + ".fwd", &bb->front());
+      atEntry[{pointer, bb}] = phi;
+      phis.push_back(phi);
+      for (BasicBlock* pred : predecessors(bb)) {
+        phi->addIncoming(reachable(pred) ? atEnd(pointer, type, pred) : UndefValue::get(type), pred);
       }
+      v = phi;
+      break;
     }
 
-    if (!changed) break;
+    for (BasicBlock* b : chain) atEntry[{pointer, b}] = v;
+    return v;
+  }
+};
+
+/* Returns the single value `phi` merges, ignoring itself, or nullptr. */
+static Value* mergedValue(PHINode* phi) {
+  Value* common = nullptr;
+  for (Value* v : phi->incoming_values()) {
+    if (v == phi) continue;
+    if (common && v != common) return nullptr;
+    common = v;
   }
+  return common;
 }
 
 /*
- * Constant propagation using store-load reaching stores.
- * Replaces loads if all reaching stores to the same address store the same constant.
+ * Copy propagation (store-to-load forwarding).
+ * Replaces a load by the value the stores reaching it wrote, stored values
+ * need not be constants. Where different stores reach a load, phis merge
+ * their values on the way (see ForwardedValues). A load is only forwarded if
+ * at least one store reaches it, every store to its address writes its type,
+ * and its address cannot have been clobbered on any path.
  */
-bool constantPropagation(LLVMValueRef function) {
-  bool changed = false;
-
-  // Collect blocks in a stable order
-  std::vector<LLVMBasicBlockRef> blocks;
-  for (LLVMBasicBlockRef b = LLVMGetFirstBasicBlock(function);
-       b != nullptr;
-       b = LLVMGetNextBasicBlock(b)) {
-    blocks.push_back(b);
-  }
-
-  // Collect all store instructions in the function
-  std::set<LLVMValueRef> allStores;
-  for (LLVMBasicBlockRef b : blocks) {
-    for (LLVMValueRef I = LLVMGetFirstInstruction(b);
-         I != nullptr;
-         I = LLVMGetNextInstruction(I)) {
-      if (isStore(I)) allStores.insert(I);
-    }
-  }
-
-  // Build preds and compute GEN/KILL/IN/OUT
-  auto preds = buildPredecessors(function, blocks);
-
-  std::unordered_map<LLVMBasicBlockRef, std::set<LLVMValueRef>> gen, kill, in, out;
-  computeGenKill(function, blocks, allStores, gen, kill);
-  computeInOut(blocks, preds, gen, kill, in, out);
-
-  // Walk each block and replace loads using running reaching set R
-  for (LLVMBasicBlockRef b : blocks) {
-    std::set<LLVMValueRef> R = in[b];
-    std::vector<LLVMValueRef> loadsToDelete;
-
-    for (LLVMValueRef I = LLVMGetFirstInstruction(b);
-         I != nullptr;
-         I = LLVMGetNextInstruction(I)) {
-
-      if (isStore(I)) {
-        LLVMValueRef ptr = storePointer(I);
-        removeStoresToPointer(R, ptr);
-        R.insert(I);
+bool copyPropagation(LLVMValueRef function) {
+  FunctionAnalyses& analyses = analysesFor(function);
+  const BlockGraph& g = analyses.cfg();
+  const StoreIndex& numbering = analyses.stores();
+  const std::vector<FactSet>& in = analyses.reachingStoresIn();
+
+  ForwardedValues values(g);
+  SmallVector<LoadInst*, 16> forwarded;
+
+  for (unsigned p = 0; p < g.numReachable; p++) {
+    unsigned b = g.order[p];
+    BasicBlock* bb = unwrap(g.blocks[b]);
+    FactSet R = in[b];
+
+    for (Instruction& I : *bb) {
+      LoadInst* load = dyn_cast<LoadInst>(&I);
+      if (!load) {
+        numbering.step(wrap(&I), R);
         continue;
       }
-
-      if (!isLoad(I)) continue;
-
-      LLVMValueRef ptr = loadPointer(I);
-
-      // Collect reaching stores to this same pointer
-      std::vector<LLVMValueRef> reachingStores;
-      for (LLVMValueRef s : R) {
-        if (storePointer(s) == ptr) reachingStores.push_back(s);
-      }
-
-      if (reachingStores.empty()) continue;
-
-      // Check all reaching stores are constant stores with the same constant
-      bool ok = true;
-      long long val = 0;
-
-      for (size_t idx = 0; idx < reachingStores.size(); idx++) {
-        LLVMValueRef s = reachingStores[idx];
-
-        if (!isConstantStore(s)) {
-          ok = false;
-          break;
-        }
-
-        long long sVal = constantStoreValue(s);
-        if (idx == 0) val = sVal;
-        else if (sVal != val) {
-          ok = false;
-          break;
-        }
+      if (!load->isSimple()) continue;
+
+      Value* pointer = load->getPointerOperand();
+      auto address = numbering.addresses.find(wrap(pointer));
+      if (address == numbering.addresses.end() || numbering.clobbered(address->second, R)) continue;
+
+      bool reached = false;
+      bool sameType = true;
+      for (unsigned s : numbering.storesTo[address->second]) {
+        reached |= R.test(s);
+        StoreInst* store = unwrap<StoreInst>(numbering.stores[s]);
+        sameType &= store->getValueOperand()->getType() == load->getType();
       }
+      if (!reached || !sameType) continue;
 
-      if (!ok) continue;
+      Value* v = ForwardedValues::storedBefore(pointer, bb, load->getIterator());
+      if (!v) v = values.entryValue(pointer, load->getType(), bb);
+      if (v == load) continue;
 
-      // Replace load with constant and mark for deletion
-      LLVMTypeRef loadTy = LLVMTypeOf(I);
-      LLVMValueRef c = LLVMConstInt(loadTy, (unsigned long long)val, 1);
-
-      LLVMReplaceAllUsesWith(I, c);
-      loadsToDelete.push_back(I);
-      changed = true;
+      load->replaceAllUsesWith(v);
+      forwarded.push_back(load);
+      passCounters.loadsReplaced++;
     }
+  }
 
-    // Delete marked loads after traversal
-    for (LLVMValueRef l : loadsToDelete) {
-      LLVMInstructionEraseFromParent(l);
+  // Erased only now: the values kept for block entries may have been loads
+  for (LoadInst* load : forwarded) load->eraseFromParent();
+  unsigned long long deleted = forwarded.size();
+
+  // Fold phis that merge one value; folding one can make another trivial
+  bool folded = true;
+  while (folded) {
+    folded = false;
+    for (PHINode*& phi : values.phis) {
+      if (!phi) continue;
+      Value* v = mergedValue(phi);
+      if (!v) continue;
+
+      phi->replaceAllUsesWith(v);
+      phi->eraseFromParent();
+      phi = nullptr;
+      deleted++;
+      folded = true;
     }
   }
 
-  return changed;
+  passCounters.instructionsDeleted += deleted;
+  return !forwarded.empty();
 }
@@ -0,0 +1,228 @@
+/*
+ * globalValueNumbering.cpp
+ *
+ * Dominator-scoped global value numbering ("gvn" in pipelines). Walks the
+ * dominator tree with a table of the expressions computed on the path from
+ * the entry block; an expression already in the table is replaced by the
+ * earlier instruction, which dominates it. Leaving a block drops what it
+ * added to the table.
+ *
+ * Loads are reused the same way when nothing can have written the address in
+ * between. That is a forward must-dataflow problem over the loads ("available
+ * loads"): a store kills the loads of its address, and calls and other
+ * writes kill loads whose address may escape. The IR builder's allocas are
+ * only loaded and stored, so they never escape and a call like print cannot
+ * change them.
+ */
+
+#include <utility>
+#include <vector>
+
+#include <llvm-c/Core.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Instructions.h>
+
+#include "analysisManager.h"
+#include "expressionKey.h"
+#include "passManager.h"
+
+using namespace llvm;
+
+/*
+ * Loads numbered in block order, grouped by address; the bits of the
+ * available-loads problem.
+ */
+struct LoadNumbering {
+  std::vector<LoadInst*> loads;
+  DenseMap<LoadInst*, unsigned> index;
+  DenseMap<Value*, FactSet> loadsFrom;  // address -> its loads
+  DenseMap<Value*, bool> localSlot;       // address -> isLocalSlot
+  FactSet escaping;                     // loads whose address may escape
+
+  /* Number of `I` if it is a load this pass may reuse, else -1. */
+  int number(Instruction* I) const {
+    LoadInst* load = dyn_cast<LoadInst>(I);
+    if (!load) return -1;
+    auto it = index.find(load);
+    return it == index.end() ? -1 : (int)it->second;
+  }
+
+  /* Loads whose value `I` may overwrite, or nullptr if it writes nothing. */
+  const FactSet* killedBy(Instruction* I) const {
+    if (StoreInst* store = dyn_cast<StoreInst>(I)) {
+      Value* pointer = store->getPointerOperand();
+      auto local = localSlot.find(pointer);
+      if (local != localSlot.end() && local->second) return &loadsFrom.find(pointer)->second;
+    }
+    return I->mayWriteToMemory() ? &escaping : nullptr;
+  }
+};
+
+static void numberLoads(const BlockGraph& g, LoadNumbering& numbering) {
+  for (LLVMBasicBlockRef block : g.blocks) {
+    for (Instruction& I : *unwrap(block)) {
+      LoadInst* load = dyn_cast<LoadInst>(&I);
+      if (!load || !load->isSimple()) continue;
+      numbering.index[load] = numbering.loads.size();
+      numbering.loads.push_back(load);
+    }
+  }
+
+  // Addresses of stores matter too: a store to a local slot only kills its loads
+  size_t bits = numbering.loads.size();
+  numbering.escaping = FactSet(bits);
+  for (LLVMBasicBlockRef block : g.blocks) {
+    for (Instruction& I : *unwrap(block)) {
+      Value* pointer = nullptr;
+      if (LoadInst* load = dyn_cast<LoadInst>(&I)) pointer = load->getPointerOperand();
+      else if (StoreInst* store = dyn_cast<StoreInst>(&I)) pointer = store->getPointerOperand();
+      if (!pointer || numbering.localSlot.count(pointer)) continue;
+
+      numbering.localSlot[pointer] = isLocalSlot(wrap(pointer));
+      numbering.loadsFrom[pointer] = FactSet(bits);
+    }
+  }
+
+  for (unsigned n = 0; n < bits; n++) {
+    Value* pointer = numbering.loads[n]->getPointerOperand();
+    numbering.loadsFrom[pointer].set(n);
+    if (!numbering.localSlot[pointer]) numbering.escaping.set(n);
+  }
+}
+
+/*
+ * Available loads at each block entry: a load is available if it ran on
+ * every path and nothing that may write its address ran since.
+ */
+static void computeAvailableLoads(const BlockGraph& g, const LoadNumbering& numbering,
+                                  std::vector<FactSet>& in) {
+  size_t n = g.blocks.size();
+  size_t bits = numbering.loads.size();
+  std::vector<FactSet> gen(n, FactSet(bits)), kill(n, FactSet(bits)), out;
+
+  for (unsigned b = 0; b < n; b++) {
+    for (Instruction& I : *unwrap(g.blocks[b])) {
+      int load = numbering.number(&I);
+      if (load >= 0) {
+        gen[b].set(load);
+        continue;
+      }
+
+      const FactSet* killed = numbering.killedBy(&I);
+      if (!killed) continue;
+      gen[b].subtract(*killed);
+      kill[b].unionWith(*killed);
+    }
+  }
+
+  passCounters.dataflowSweeps += DataflowSolver<DataflowDirection::Forward, IntersectMeet>::solve(
+      g, bits, gen, kill, in, out);
+}
+
+/*
+ * Global Value Numbering
+ * Replaces pure expressions and loads already computed in a dominating
+ * position; see the top of this file.
+ */
+bool globalValueNumbering(LLVMValueRef function) {
+  FunctionAnalyses& analyses = analysesFor(function);
+  const BlockGraph& g = analyses.cfg();
+  if (g.numReachable == 0) return false;
+  const BlockDominators& dt = analyses.dominators();
+
+  LoadNumbering numbering;
+  numberLoads(g, numbering);
+  std::vector<FactSet> in;
+  computeAvailableLoads(g, numbering, in);
+
+  // Scoped tables: entries added in a block are undone when the walk leaves it
+  DenseMap<ExprKey, Instruction*, ExprKeyInfo> exprs;
+  // Keyed on address and loaded type: an i64 load of an i32 slot is not a reuse
+  using LoadKey = std::pair<Value*, Type*>;
+  DenseMap<LoadKey, LoadInst*> lastLoad;
+  std::vector<ExprKey> exprUndo;
+  std::vector<std::pair<LoadKey, LoadInst*>> loadUndo;  // key, previous load
+
+  struct Scope {
+    unsigned block;
+    size_t nextChild;
+    size_t exprMark;
+    size_t loadMark;
+  };
+  std::vector<Scope> stack;
+  bool changed = false;
+
+  auto enter = [&](unsigned b) {
+    stack.push_back({b, 0, exprUndo.size(), loadUndo.size()});
+    FactSet available = in[b];
+
+    BasicBlock* bb = unwrap(g.blocks[b]);
+    for (auto it = bb->begin(); it != bb->end();) {
+      Instruction* I = &*it++;
+
+      ExprKey key;
+      if (makeExprKey(*I, key)) {
+        auto inserted = exprs.insert({key, I});
+        if (inserted.second) {
+          exprUndo.push_back(key);
+          continue;
+        }
+        inserted.first->second->andIRFlags(I);
+        I->replaceAllUsesWith(inserted.first->second);
+        I->eraseFromParent();
+        passCounters.expressionsReused++;
+        passCounters.instructionsDeleted++;
+        changed = true;
+        continue;
+      }
+
+      int n = numbering.number(I);
+      if (n < 0) {
+        if (const FactSet* killed = numbering.killedBy(I)) available.subtract(*killed);
+        continue;
+      }
+
+      LoadInst* load = cast<LoadInst>(I);
+      LoadKey loadKey(load->getPointerOperand(), load->getType());
+      auto found = lastLoad.find(loadKey);
+      if (found != lastLoad.end() && available.test(numbering.number(found->second))) {
+        load->replaceAllUsesWith(found->second);
+        load->eraseFromParent();
+        passCounters.loadsReplaced++;
+        passCounters.instructionsDeleted++;
+        changed = true;
+        continue;
+      }
+
+      loadUndo.push_back({loadKey, found == lastLoad.end() ? nullptr : found->second});
+      lastLoad[loadKey] = load;
+      available.set(n);
+    }
+  };
+
+  enter(g.order[0]);
+  while (!stack.empty()) {
+    Scope& scope = stack.back();
+    const std::vector<unsigned>& children = dt.children[scope.block];
+    if (scope.nextChild < children.size()) {
+      enter(children[scope.nextChild++]);
+      continue;
+    }
+
+    // Leaving the block: restore the tables to how its parent saw them
+    while (exprUndo.size() > scope.exprMark) {
+      exprs.erase(exprUndo.back());
+      exprUndo.pop_back();
+    }
+    while (loadUndo.size() > scope.loadMark) {
+      if (loadUndo.back().second) lastLoad[loadUndo.back().first] = loadUndo.back().second;
+      else lastLoad.erase(loadUndo.back().first);
+      loadUndo.pop_back();
+    }
+    stack.pop_back();
+  }
+
+  return changed;
+}
@@ -3,137 +3,144 @@
  *
  * Implements local optimizations on LLVM IR functions.
  * Passes in this file:
- *  1) Constant Folding for integer add sub mul with constant operands
- *  2) Dead Code Elimination for unused non side effect instructions
- *  3) Common Subexpression Elimination for duplicate instructions
+ *  1) Constant Folding for integer arithmetic, comparisons, casts, selects
+ *     and branches with constant operands
+ *  2) Dead Code Elimination for unused non side effect instructions, plus
+ *     an aggressive mark-and-sweep variant that also removes dead cycles
+ *  3) Common Subexpression Elimination for duplicate loads and expressions
+ *
+ * The passes take the C API function handle the pass manager uses and work
+ * on llvm::Function directly.
  */
 
-#include <vector>
-#include <unordered_map>
 #include <llvm-c/Core.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/InstVisitor.h>
+#include <llvm/IR/Instructions.h>
+
+#include "analysisManager.h"
+#include "constantEvaluation.h"
+#include "controlFlowEdits.h"
+#include "expressionKey.h"
+#include "passManager.h"
+
+using namespace llvm;
 
 /*
- * Returns true for instructions that must not be removed.
- * These affect memory or control flow.
+ * Folds integer arithmetic, icmp and casts whose operands are all constants,
+ * and selects on a constant condition. Uses are replaced right away, so
+ * later instructions in the walk see the folded value; the instructions
+ * themselves are erased after the walk. Branches on a constant are only
+ * collected, since rewriting them changes the CFG being walked.
  */
-static bool isSideEffect(LLVMValueRef I) {
-  LLVMOpcode op = LLVMGetInstructionOpcode(I);
-
-  if (op == LLVMStore) return true;
-  if (op == LLVMCall) return true;
-  if (op == LLVMAlloca) return true;
-  if (LLVMIsATerminatorInst(I)) return true;
+struct FoldVisitor : public InstVisitor<FoldVisitor> {
+  SmallVector<Instruction*, 16> folded;
+  SmallVector<BranchInst*, 4> branches;
 
-  return false;
-}
+  void visitInstruction(Instruction& I) {
+    ConstantInt* c = foldConstantOperands(I);
+    if (!c) return;
 
-/*
- * Constant Folding
- * Replaces add sub mul instructions when both operands are constants.
- */
-bool constantFolding(LLVMValueRef function) {
-  bool changed = false;
-  std::vector<LLVMValueRef> toDelete;
-
-  // Walk all basic blocks and instructions
-  for (LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(function);
-       bb != nullptr;
-       bb = LLVMGetNextBasicBlock(bb)) {
-
-    for (LLVMValueRef I = LLVMGetFirstInstruction(bb);
-         I != nullptr;
-         I = LLVMGetNextInstruction(I)) {
-
-      LLVMOpcode op = LLVMGetInstructionOpcode(I);
-      if (!(op == LLVMAdd || op == LLVMSub || op == LLVMMul)) continue;
+    I.replaceAllUsesWith(c);
+    folded.push_back(&I);
+  }
 
-      LLVMValueRef a = LLVMGetOperand(I, 0);
-      LLVMValueRef b = LLVMGetOperand(I, 1);
+  void visitSelectInst(SelectInst& I) {
+    ConstantInt* cond = dyn_cast<ConstantInt>(I.getCondition());
+    if (!cond) return;
 
-      // Only fold when both operands are constants
-      if (!LLVMIsAConstant(a) || !LLVMIsAConstant(b)) continue;
+    // A select can only name itself in unreachable code; leave that alone
+    Value* chosen = cond->isZero() ? I.getFalseValue() : I.getTrueValue();
+    if (chosen == &I) return;
 
-      LLVMValueRef folded = nullptr;
-      if (op == LLVMAdd) folded = LLVMConstAdd(a, b);
-      else if (op == LLVMSub) folded = LLVMConstSub(a, b);
-      else folded = LLVMConstMul(a, b);
+    I.replaceAllUsesWith(chosen);
+    folded.push_back(&I);
+  }
 
-      // Replace instruction uses and mark for deletion
-      LLVMReplaceAllUsesWith(I, folded);
-      toDelete.push_back(I);
-      changed = true;
-    }
+  void visitBranchInst(BranchInst& I) {
+    if (I.isConditional() && isa<ConstantInt>(I.getCondition())) branches.push_back(&I);
   }
+};
+
+/*
+ * Constant Folding
+ * Replaces instructions whose operands are constants (add sub mul sdiv srem,
+ * bitwise and shift operators, every icmp predicate, zext sext trunc, and
+ * select on a constant condition), then rewrites branches on a constant to
+ * unconditional ones and deletes the blocks no longer reachable. Division
+ * by zero and INT_MIN / -1 are left for run time.
+ */
+bool constantFolding(LLVMValueRef function) {
+  Function& F = *unwrap<Function>(function);
+  FoldVisitor visitor;
+  visitor.visit(F);
 
   // Remove folded instructions
-  for (LLVMValueRef I : toDelete) {
-    LLVMInstructionEraseFromParent(I);
-  }
+  for (Instruction* I : visitor.folded) I->eraseFromParent();
+  passCounters.instructionsFolded += visitor.folded.size();
+  passCounters.instructionsDeleted += visitor.folded.size();
 
+  bool changed = !visitor.folded.empty();
+  for (BranchInst* br : visitor.branches) changed |= foldConstantBranch(br);
+  changed |= deleteUnreachableBlocks(F) > 0;
   return changed;
 }
 
 /*
  * Common Subexpression Elimination
- * Eliminates duplicate loads and duplicate add sub mul instructions within a basic block.
- * A load can be reused if no store writes to the same address in between.
+ * Eliminates duplicate loads and duplicate expressions (add sub mul sdiv
+ * icmp zext select) within a basic block. Expressions are looked up in a
+ * hash table of value-numbering keys. A load can be reused if no store
+ * writes to the same address in between.
  */
 bool commonSubexpressionElimination(LLVMValueRef function) {
   bool changed = false;
 
-  for (LLVMBasicBlockRef basicBlock = LLVMGetFirstBasicBlock(function);
-       basicBlock != nullptr;
-       basicBlock = LLVMGetNextBasicBlock(basicBlock)) {
+  DenseMap<Value*, LoadInst*> lastLoad;
+  DenseMap<ExprKey, Instruction*, ExprKeyInfo> seenExprs;
 
-    std::unordered_map<LLVMValueRef, LLVMValueRef> lastLoad;
-    std::vector<LLVMValueRef> seenExprs;
+  for (BasicBlock& basicBlock : *unwrap<Function>(function)) {
+    lastLoad.clear();
+    seenExprs.clear();
 
-    for (LLVMValueRef instruction = LLVMGetFirstInstruction(basicBlock);
-         instruction != nullptr;
-         instruction = LLVMGetNextInstruction(instruction)) {
-
-      LLVMOpcode op = LLVMGetInstructionOpcode(instruction);
+    for (Instruction& instruction : basicBlock) {
 
       // Store kills previous loads from that same address
-      if (op == LLVMStore) {
-        LLVMValueRef storePtr = LLVMGetOperand(instruction, 1);
-        lastLoad.erase(storePtr);
+      if (StoreInst* store = dyn_cast<StoreInst>(&instruction)) {
+        lastLoad.erase(store->getPointerOperand());
         continue;
       }
 
-      // Reuse repeated loads from the same address
-      if (op == LLVMLoad) {
-        LLVMValueRef loadPtr = LLVMGetOperand(instruction, 0);
+      // Reuse repeated loads of the same type from the same address
+      if (LoadInst* load = dyn_cast<LoadInst>(&instruction)) {
+        auto inserted = lastLoad.insert({load->getPointerOperand(), load});
+        if (inserted.second) continue;
 
-        auto it = lastLoad.find(loadPtr);
-        if (it != lastLoad.end()) {
-          LLVMReplaceAllUsesWith(instruction, it->second);
-          changed = true;
+        if (inserted.first->second->getType() != load->getType()) {
+          inserted.first->second = load;
         } else {
-          lastLoad[loadPtr] = instruction;
+          load->replaceAllUsesWith(inserted.first->second);
+          passCounters.loadsReplaced++;
+          changed = true;
         }
         continue;
       }
 
-      // Reuse repeated arithmetic expressions
-      if (!(op == LLVMAdd || op == LLVMSub || op == LLVMMul))
-        continue;
-
-      LLVMValueRef operand0 = LLVMGetOperand(instruction, 0);
-      LLVMValueRef operand1 = LLVMGetOperand(instruction, 1);
-
-      for (LLVMValueRef prev : seenExprs) {
-        if (LLVMGetInstructionOpcode(prev) != op) continue;
+      // Reuse repeated expressions
+      ExprKey key;
+      if (!makeExprKey(instruction, key)) continue;
 
-        if (LLVMGetOperand(prev, 0) == operand0 &&
-            LLVMGetOperand(prev, 1) == operand1) {
-          LLVMReplaceAllUsesWith(instruction, prev);
-          changed = true;
-          break;
-        }
+      auto inserted = seenExprs.insert({key, &instruction});
+      if (!inserted.second) {
+        inserted.first->second->andIRFlags(&instruction);
+        instruction.replaceAllUsesWith(inserted.first->second);
+        passCounters.expressionsReused++;
+        changed = true;
       }
-
-      seenExprs.push_back(instruction);
     }
   }
 
@@ -143,40 +150,95 @@ bool commonSubexpressionElimination(LLVMValueRef function) {
 
 /*
  * Dead Code Elimination
- * Removes instructions that have no uses and no side effects.
+ * Removes instructions that have no uses and no side effects. Starts from
+ * the use-free instructions and, after each deletion, queues operands whose
+ * last use just went away, so a dead chain is removed in one pass.
  */
 bool deadCodeElimination(LLVMValueRef function) {
-  bool changed = false;
+  SmallVector<Instruction*, 64> worklist;
+  DenseSet<Instruction*> queued;
 
-  while (true) {
-    std::vector<LLVMValueRef> toDelete;
+  // Seed with every unused instruction
+  for (BasicBlock& bb : *unwrap<Function>(function)) {
+    for (Instruction& I : bb) {
+      if (!I.use_empty()) continue;
+      if (isSideEffect(wrap(&I))) continue;
 
-    // Scan for unused instructions
-    for (LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(function);
-         bb != nullptr;
-         bb = LLVMGetNextBasicBlock(bb)) {
+      worklist.push_back(&I);
+      queued.insert(&I);
+    }
+  }
 
-      for (LLVMValueRef I = LLVMGetFirstInstruction(bb);
-           I != nullptr;
-           I = LLVMGetNextInstruction(I)) {
+  bool changed = !worklist.empty();
+  SmallVector<Instruction*, 4> operands;
 
-        if (LLVMGetFirstUse(I) != nullptr) continue;
-        if (isSideEffect(I)) continue;
+  while (!worklist.empty()) {
+    Instruction* I = worklist.pop_back_val();
 
-        toDelete.push_back(I);
-      }
+    operands.clear();
+    for (Value* op : I->operands()) {
+      if (Instruction* opInst = dyn_cast<Instruction>(op)) operands.push_back(opInst);
     }
 
-    // Stop if nothing to delete
-    if (toDelete.empty()) break;
+    I->eraseFromParent();
+    passCounters.instructionsDeleted++;
 
-    // Delete collected instructions
-    for (LLVMValueRef I : toDelete) {
-      LLVMInstructionEraseFromParent(I);
+    // Operands that lost their last use are dead now
+    for (Instruction* op : operands) {
+      if (!op->use_empty()) continue;
+      if (isSideEffect(wrap(op))) continue;
+      if (!queued.insert(op).second) continue;
+      worklist.push_back(op);
     }
-
-    changed = true;
   }
 
   return changed;
 }
+
+/*
+ * Aggressive Dead Code Elimination
+ * Assumes everything is dead except instructions with side effects and the
+ * operands they (transitively) need, then deletes the rest. Unlike
+ * deadCodeElimination this also removes dead cycles, such as a phi that is
+ * only used by the add feeding it.
+ */
+bool aggressiveDeadCodeElimination(LLVMValueRef function) {
+  Function& F = *unwrap<Function>(function);
+  DenseSet<Instruction*> live;
+  SmallVector<Instruction*, 64> worklist;
+
+  // Mark: side-effect instructions are the roots
+  for (BasicBlock& bb : F) {
+    for (Instruction& I : bb) {
+      if (isSideEffect(wrap(&I)) && live.insert(&I).second) worklist.push_back(&I);
+    }
+  }
+
+  while (!worklist.empty()) {
+    Instruction* I = worklist.pop_back_val();
+
+    for (Value* op : I->operands()) {
+      Instruction* opInst = dyn_cast<Instruction>(op);
+      if (opInst && live.insert(opInst).second) worklist.push_back(opInst);
+    }
+  }
+
+  // Sweep: every user of a dead instruction is dead too, so uses can be
+  // cut before anything is erased
+  SmallVector<Instruction*, 64> dead;
+  for (BasicBlock& bb : F) {
+    for (Instruction& I : bb) {
+      if (!live.count(&I)) dead.push_back(&I);
+    }
+  }
+
+  for (Instruction* I : dead) {
+    if (!I->use_empty()) I->replaceAllUsesWith(UndefValue::get(I->getType()));
+  }
+  for (Instruction* I : dead) {
+    I->eraseFromParent();
+  }
+  passCounters.instructionsDeleted += dead.size();
+
+  return !dead.empty();
+}
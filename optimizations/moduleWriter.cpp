@@ -0,0 +1,351 @@
+/*
+ * moduleWriter.cpp
+ *
+ * Writes an optimized module as textual IR without first building the whole
+ * module as one string. Function bodies are printed into per-function buffers
+ * by a small pool of threads, one window of functions at a time, and each
+ * window is handed to the output descriptor with vectored writes.
+ *
+ * The text is byte-for-byte what LLVMPrintModuleToString produces. Slot
+ * numbers (attribute groups, metadata) are module-wide, so every worker keeps
+ * its own ModuleSlotTracker and incorporates earlier functions that introduce
+ * call-site attribute groups before printing its own.
+ *
+ * Lazily loaded bitcode modules are written one function at a time instead:
+ * materialize, optimize, print, then drop the body, so only one function
+ * body is in memory at once.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <llvm-c/Core.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/IR/Attributes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/ModuleSlotTracker.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace llvm;
+
+/* Functions printed per window for each worker; bounds buffered output. */
+static const unsigned FUNCTIONS_PER_WORKER = 8;
+
+/*
+ * Writes every buffer in order, retrying short writes and EINTR.
+ */
+static bool writeAll(int fd, const std::vector<std::string>& buffers) {
+  std::vector<struct iovec> iov;
+  iov.reserve(buffers.size());
+  for (const std::string& b : buffers) {
+    if (b.empty()) continue;
+    iov.push_back({const_cast<char*>(b.data()), b.size()});
+  }
+
+  size_t next = 0;
+  while (next < iov.size()) {
+    int count = (int)std::min<size_t>(iov.size() - next, IOV_MAX);
+    ssize_t n = writev(fd, &iov[next], count);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+
+    // Skip fully written entries, then trim a partially written one
+    size_t left = (size_t)n;
+    while (next < iov.size() && left >= iov[next].iov_len) {
+      left -= iov[next].iov_len;
+      next++;
+    }
+    if (left > 0) {
+      iov[next].iov_base = (char*)iov[next].iov_base + left;
+      iov[next].iov_len -= left;
+    }
+  }
+  return true;
+}
+
+/*
+ * Returns true when the module only uses constructs this writer mirrors.
+ * Anything else goes through the serial streaming printer.
+ */
+static bool canSplitByFunction(const Module& M) {
+  if (!M.getModuleInlineAsm().empty()) return false;
+  if (!M.getComdatSymbolTable().empty()) return false;
+  if (!M.alias_empty() || !M.ifunc_empty()) return false;
+  if (!M.getIdentifiedStructTypes().empty()) return false;
+  return true;
+}
+
+/*
+ * Attribute groups in the order the slot tracker numbers them: global and
+ * function attributes first, then call-site attributes in instruction order.
+ */
+struct AttrGroups {
+  std::vector<AttributeSet> sets;
+  DenseMap<AttributeSet, unsigned> slots;
+
+  bool add(AttributeSet AS) {
+    if (!AS.hasAttributes() || slots.count(AS)) return false;
+    slots[AS] = sets.size();
+    sets.push_back(AS);
+    return true;
+  }
+
+  void addModuleLevel(const Module& M) {
+    for (const GlobalVariable& GV : M.globals()) add(GV.getAttributes());
+    for (const Function& F : M) add(F.getAttributes().getFnAttrs());
+  }
+
+  /* Adds F's call-site groups; returns true if any of them were new. */
+  bool addCallSites(const Function& F) {
+    bool added = false;
+    for (const BasicBlock& BB : F) {
+      for (const Instruction& I : BB) {
+        if (const CallBase* call = dyn_cast<CallBase>(&I))
+          added |= add(call->getAttributes().getFnAttrs());
+      }
+    }
+    return added;
+  }
+};
+
+/*
+ * Streams the whole module with the regular printer.
+ */
+static bool writeSerially(const Module& M, int fd) {
+  raw_fd_ostream OS(fd, /*shouldClose*/ false);
+  M.print(OS, nullptr);
+  OS.flush();
+  return !OS.has_error();
+}
+
+/*
+ * Reports a materialization error; returns true if there was none.
+ */
+static bool materialized(Error err) {
+  if (!err) return true;
+  errs() << "Error reading bitcode: " << toString(std::move(err)) << "\n";
+  return false;
+}
+
+/*
+ * Per-thread printing state. The tracker remembers how far into the module
+ * it has incorporated so each worker scans earlier functions only once.
+ */
+struct Worker {
+  ModuleSlotTracker tracker;
+  size_t incorporated = 0;
+
+  explicit Worker(const Module* M) : tracker(M) {}
+};
+
+/*
+ * Prints function `index` into `out`, first incorporating earlier functions
+ * whose call sites add attribute groups so the #N numbers agree with a
+ * whole-module print.
+ */
+static void printFunction(Worker& w,
+                          const std::vector<const Function*>& functions,
+                          const std::vector<bool>& addsCallAttrs,
+                          size_t index,
+                          std::string& out) {
+  for (; w.incorporated < index; w.incorporated++) {
+    if (!addsCallAttrs[w.incorporated]) continue;
+    const Function* F = functions[w.incorporated];
+    w.tracker.incorporateFunction(*F);
+    w.tracker.getLocalSlot(&F->front());
+  }
+
+  raw_string_ostream OS(out);
+  OS << '\n';
+  static_cast<const Value*>(functions[index])->print(OS, w.tracker);
+  OS.flush();
+  w.incorporated = index + 1;
+}
+
+/*
+ * Writes module header and globals: everything printed before the first
+ * function.
+ */
+static std::string printHeader(const Module& M, ModuleSlotTracker& MST) {
+  std::string text;
+  raw_string_ostream OS(text);
+
+  const std::string& id = M.getModuleIdentifier();
+  if (!id.empty() && id.find('\n') == std::string::npos)
+    OS << "; ModuleID = '" << id << "'\n";
+
+  if (!M.getSourceFileName().empty()) {
+    OS << "source_filename = \"";
+    printEscapedString(M.getSourceFileName(), OS);
+    OS << "\"\n";
+  }
+
+  const std::string& dl = M.getDataLayoutStr();
+  if (!dl.empty()) OS << "target datalayout = \"" << dl << "\"\n";
+  if (!M.getTargetTriple().empty())
+    OS << "target triple = \"" << M.getTargetTriple() << "\"\n";
+
+  if (!M.global_empty()) OS << '\n';
+  for (const GlobalVariable& GV : M.globals()) {
+    GV.print(OS, MST);
+    OS << '\n';
+  }
+
+  OS.flush();
+  return text;
+}
+
+/*
+ * Writes attribute groups, named metadata and metadata nodes: everything
+ * printed after the last function.
+ */
+static std::string printTrailer(const Module& M, ModuleSlotTracker& MST,
+                                const AttrGroups& groups) {
+  std::string text;
+  raw_string_ostream OS(text);
+
+  if (!groups.sets.empty()) OS << '\n';
+  for (size_t i = 0; i < groups.sets.size(); i++) {
+    OS << "attributes #" << i << " = { " << groups.sets[i].getAsString(true)
+       << " }\n";
+  }
+
+  if (!M.named_metadata_empty()) OS << '\n';
+  for (const NamedMDNode& NMD : M.named_metadata()) NMD.print(OS, MST);
+
+  ModuleSlotTracker::MachineMDNodeListType nodes;
+  MST.getMachine();
+  MST.collectMDNodes(nodes, 0, UINT_MAX);
+  std::sort(nodes.begin(), nodes.end(),
+            [](const std::pair<unsigned, const MDNode*>& a,
+               const std::pair<unsigned, const MDNode*>& b) {
+              return a.first < b.first;
+            });
+
+  if (!nodes.empty()) OS << '\n';
+  for (const auto& slotAndNode : nodes) {
+    slotAndNode.second->print(OS, MST, &M);
+    OS << '\n';
+  }
+
+  OS.flush();
+  return text;
+}
+
+/*
+ * Writes `module` as textual IR to `fd` using up to `jobs` printing threads
+ * (0 picks the hardware concurrency). Returns false on a write error.
+ */
+bool writeModule(LLVMModuleRef module, int fd, unsigned jobs) {
+  const Module& M = *unwrap(module);
+
+  if (!canSplitByFunction(M)) return writeSerially(M, fd);
+
+  if (jobs == 0) jobs = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<const Function*> functions;
+  std::vector<bool> addsCallAttrs;
+  AttrGroups groups;
+
+  groups.addModuleLevel(M);
+  for (const Function& F : M) {
+    functions.push_back(&F);
+    addsCallAttrs.push_back(groups.addCallSites(F));
+  }
+
+  jobs = std::max<size_t>(1, std::min<size_t>(jobs, functions.size()));
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (unsigned w = 0; w < jobs; w++) workers.emplace_back(new Worker(&M));
+
+  bool ok = writeAll(fd, {printHeader(M, workers[0]->tracker)});
+
+  // Print one window of functions in parallel, write it, then reuse buffers
+  size_t window = (size_t)jobs * FUNCTIONS_PER_WORKER;
+  std::vector<std::string> buffers;
+
+  for (size_t start = 0; ok && start < functions.size(); start += window) {
+    size_t end = std::min(functions.size(), start + window);
+    buffers.assign(end - start, std::string());
+
+    auto run = [&](unsigned w) {
+      for (size_t i = start + w; i < end; i += jobs) {
+        printFunction(*workers[w], functions, addsCallAttrs, i, buffers[i - start]);
+      }
+    };
+
+    if (jobs == 1) {
+      run(0);
+    } else {
+      std::vector<std::thread> threads;
+      for (unsigned w = 0; w < jobs; w++) threads.emplace_back(run, w);
+      for (std::thread& t : threads) t.join();
+    }
+
+    ok = writeAll(fd, buffers);
+  }
+
+  if (ok) ok = writeAll(fd, {printTrailer(M, workers[0]->tracker, groups)});
+
+  return ok;
+}
+
+/*
+ * Writes a lazily loaded module to `fd`, materializing each function just
+ * before `optimize` runs on it and deleting its body once it is written.
+ * Functions are handled in module order on the calling thread, since the
+ * bitcode reader is shared. Returns false on a read or write error.
+ */
+bool writeModuleLazily(LLVMModuleRef module, int fd, void (*optimize)(LLVMValueRef)) {
+  Module& M = *unwrap(module);
+
+  if (!canSplitByFunction(M)) {
+    if (!materialized(M.materializeAll())) return false;
+    for (Function& F : M) optimize(wrap(&F));
+    return writeSerially(M, fd);
+  }
+
+  // One tracker numbers metadata and call-site groups as functions are
+  // printed, exactly as a whole-module print would
+  ModuleSlotTracker tracker(&M, /*ShouldInitializeAllMetadata*/ false);
+  AttrGroups groups;
+  groups.addModuleLevel(M);
+
+  bool ok = writeAll(fd, {printHeader(M, tracker)});
+
+  for (Function& F : M) {
+    if (!ok) break;
+    if (!materialized(F.materialize())) return false;
+
+    optimize(wrap(&F));
+    groups.addCallSites(F);
+
+    std::string text;
+    raw_string_ostream OS(text);
+    OS << '\n';
+    static_cast<const Value&>(F).print(OS, tracker);
+    OS.flush();
+    ok = writeAll(fd, {text});
+
+    // Printed text is all that is needed from here on
+    if (!F.isDeclaration()) F.deleteBody();
+  }
+
+  if (ok) ok = writeAll(fd, {printTrailer(M, tracker, groups)});
+
+  return ok;
+}
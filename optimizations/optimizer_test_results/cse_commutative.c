@@ -0,0 +1,15 @@
+extern void print(int);
+extern int read();
+
+int func(int p, int q){
+	int a;
+	int b;
+	int c;
+	int d;
+	a = p + q;
+	b = q + p;
+	c = p < q;
+	d = q > p;
+
+	return (a*b + c + d);
+}
@@ -0,0 +1,54 @@
+; ModuleID = 'cse_commutative.c'
+source_filename = "cse_commutative.c"
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+
+; Function Attrs: noinline nounwind optnone uwtable
+define dso_local i32 @func(i32 noundef %0, i32 noundef %1) #0 {
+  %3 = alloca i32, align 4
+  %4 = alloca i32, align 4
+  %5 = alloca i32, align 4
+  %6 = alloca i32, align 4
+  %7 = alloca i32, align 4
+  %8 = alloca i32, align 4
+  store i32 %0, ptr %3, align 4
+  store i32 %1, ptr %4, align 4
+  %9 = load i32, ptr %3, align 4
+  %10 = load i32, ptr %4, align 4
+  %11 = add nsw i32 %9, %10
+  store i32 %11, ptr %5, align 4
+  %12 = load i32, ptr %4, align 4
+  %13 = load i32, ptr %3, align 4
+  %14 = add nsw i32 %12, %13
+  store i32 %14, ptr %6, align 4
+  %15 = load i32, ptr %3, align 4
+  %16 = load i32, ptr %4, align 4
+  %17 = icmp slt i32 %15, %16
+  %18 = zext i1 %17 to i32
+  store i32 %18, ptr %7, align 4
+  %19 = load i32, ptr %4, align 4
+  %20 = load i32, ptr %3, align 4
+  %21 = icmp sgt i32 %19, %20
+  %22 = zext i1 %21 to i32
+  store i32 %22, ptr %8, align 4
+  %23 = load i32, ptr %5, align 4
+  %24 = load i32, ptr %6, align 4
+  %25 = mul nsw i32 %23, %24
+  %26 = load i32, ptr %7, align 4
+  %27 = add nsw i32 %25, %26
+  %28 = load i32, ptr %8, align 4
+  %29 = add nsw i32 %27, %28
+  ret i32 %29
+}
+
+attributes #0 = { noinline nounwind optnone uwtable "frame-pointer"="all" "min-legal-vector-width"="0" "no-trapping-math"="true" "stack-protector-buffer-size"="8" "target-cpu"="x86-64" "target-features"="+cx8,+fxsr,+mmx,+sse,+sse2,+x87" "tune-cpu"="generic" }
+
+!llvm.module.flags = !{!0, !1, !2, !3, !4}
+!llvm.ident = !{!5}
+
+!0 = !{i32 1, !"wchar_size", i32 4}
+!1 = !{i32 7, !"PIC Level", i32 2}
+!2 = !{i32 7, !"PIE Level", i32 2}
+!3 = !{i32 7, !"uwtable", i32 2}
+!4 = !{i32 7, !"frame-pointer", i32 2}
+!5 = !{!"Ubuntu clang version 15.0.7"}
@@ -0,0 +1,14 @@
+; dce and adce must keep unused accesses that still have an effect:
+; volatile and atomic loads, atomicrmw and fences. The plain load and the
+; add that uses it are dead and go away.
+source_filename = "dce_side_effects.ll"
+
+define dso_local void @touch(ptr noundef %p) {
+  %1 = load volatile i32, ptr %p, align 4
+  %2 = atomicrmw add ptr %p, i32 1 seq_cst, align 4
+  %3 = load atomic i32, ptr %p acquire, align 4
+  fence seq_cst
+  %4 = load i32, ptr %p, align 4
+  %5 = add nsw i32 %4, 1
+  ret void
+}
@@ -0,0 +1,10 @@
+; ModuleID = 'dce_side_effects.ll'
+source_filename = "dce_side_effects.ll"
+
+define dso_local void @touch(ptr noundef %p) {
+  %1 = load volatile i32, ptr %p, align 4
+  %2 = atomicrmw add ptr %p, i32 1 seq_cst, align 4
+  %3 = load atomic i32, ptr %p acquire, align 4
+  fence seq_cst
+  ret void
+}
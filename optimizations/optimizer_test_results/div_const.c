@@ -0,0 +1,55 @@
+extern void print(int);
+extern int read();
+
+int func(int p){
+	int big;
+	int small;
+	int n;
+	int d;
+	int i;
+
+	big = 2147483647;
+	small = 0 - big;
+	small = small - 1;
+
+	print(big / 3);
+	print(big / 7);
+	print(big / 1024);
+	print(big / 2147483647);
+	print(small / 3);
+	print(small / 7);
+	print(small / 2);
+	print(small / 1024);
+	print(small / 1073741824);
+	print(small / 2147483647);
+
+	d = 0 - 7;
+	print(big / d);
+	print(small / d);
+	d = 0 - 2147483647;
+	d = d - 1;
+	print(big / d);
+	print(small / d);
+
+	n = 0 - p;
+	print(p / 3);
+	print(n / 3);
+	print(n / 10);
+	print(p / 641);
+	print(n / 1);
+
+	i = 0;
+	n = 0 - 50;
+	while (i < 100){
+		print(n / 7);
+		print(n / 8);
+		d = 0 - 6;
+		print(n / d);
+		d = 0 - 16;
+		print(n / d);
+		n = n + 1;
+		i = i + 1;
+	}
+
+	return big / 5;
+}
@@ -0,0 +1,141 @@
+; ModuleID = 'minic_module'
+source_filename = "minic_module"
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+
+declare void @print(i32)
+
+declare i32 @read()
+
+define i32 @func(i32 %0) #0 {
+entry:
+  %p = alloca i32, align 4
+  %big = alloca i32, align 4
+  %small = alloca i32, align 4
+  %n = alloca i32, align 4
+  %d = alloca i32, align 4
+  %i = alloca i32, align 4
+  %ret = alloca i32, align 4
+  store i32 %0, ptr %p, align 4
+  store i32 2147483647, ptr %big, align 4
+  %loadtmp = load i32, ptr %big, align 4
+  %subtmp = sub i32 0, %loadtmp
+  store i32 %subtmp, ptr %small, align 4
+  %loadtmp1 = load i32, ptr %small, align 4
+  %subtmp2 = sub i32 %loadtmp1, 1
+  store i32 %subtmp2, ptr %small, align 4
+  %loadtmp3 = load i32, ptr %big, align 4
+  %divtmp = sdiv i32 %loadtmp3, 3
+  call void @print(i32 %divtmp)
+  %loadtmp4 = load i32, ptr %big, align 4
+  %divtmp5 = sdiv i32 %loadtmp4, 7
+  call void @print(i32 %divtmp5)
+  %loadtmp6 = load i32, ptr %big, align 4
+  %divtmp7 = sdiv i32 %loadtmp6, 1024
+  call void @print(i32 %divtmp7)
+  %loadtmp8 = load i32, ptr %big, align 4
+  %divtmp9 = sdiv i32 %loadtmp8, 2147483647
+  call void @print(i32 %divtmp9)
+  %loadtmp10 = load i32, ptr %small, align 4
+  %divtmp11 = sdiv i32 %loadtmp10, 3
+  call void @print(i32 %divtmp11)
+  %loadtmp12 = load i32, ptr %small, align 4
+  %divtmp13 = sdiv i32 %loadtmp12, 7
+  call void @print(i32 %divtmp13)
+  %loadtmp14 = load i32, ptr %small, align 4
+  %divtmp15 = sdiv i32 %loadtmp14, 2
+  call void @print(i32 %divtmp15)
+  %loadtmp16 = load i32, ptr %small, align 4
+  %divtmp17 = sdiv i32 %loadtmp16, 1024
+  call void @print(i32 %divtmp17)
+  %loadtmp18 = load i32, ptr %small, align 4
+  %divtmp19 = sdiv i32 %loadtmp18, 1073741824
+  call void @print(i32 %divtmp19)
+  %loadtmp20 = load i32, ptr %small, align 4
+  %divtmp21 = sdiv i32 %loadtmp20, 2147483647
+  call void @print(i32 %divtmp21)
+  store i32 -7, ptr %d, align 4
+  %loadtmp22 = load i32, ptr %big, align 4
+  %loadtmp23 = load i32, ptr %d, align 4
+  %divtmp24 = sdiv i32 %loadtmp22, %loadtmp23
+  call void @print(i32 %divtmp24)
+  %loadtmp25 = load i32, ptr %small, align 4
+  %loadtmp26 = load i32, ptr %d, align 4
+  %divtmp27 = sdiv i32 %loadtmp25, %loadtmp26
+  call void @print(i32 %divtmp27)
+  store i32 -2147483647, ptr %d, align 4
+  %loadtmp28 = load i32, ptr %d, align 4
+  %subtmp29 = sub i32 %loadtmp28, 1
+  store i32 %subtmp29, ptr %d, align 4
+  %loadtmp30 = load i32, ptr %big, align 4
+  %loadtmp31 = load i32, ptr %d, align 4
+  %divtmp32 = sdiv i32 %loadtmp30, %loadtmp31
+  call void @print(i32 %divtmp32)
+  %loadtmp33 = load i32, ptr %small, align 4
+  %loadtmp34 = load i32, ptr %d, align 4
+  %divtmp35 = sdiv i32 %loadtmp33, %loadtmp34
+  call void @print(i32 %divtmp35)
+  %loadtmp36 = load i32, ptr %p, align 4
+  %subtmp37 = sub i32 0, %loadtmp36
+  store i32 %subtmp37, ptr %n, align 4
+  %loadtmp38 = load i32, ptr %p, align 4
+  %divtmp39 = sdiv i32 %loadtmp38, 3
+  call void @print(i32 %divtmp39)
+  %loadtmp40 = load i32, ptr %n, align 4
+  %divtmp41 = sdiv i32 %loadtmp40, 3
+  call void @print(i32 %divtmp41)
+  %loadtmp42 = load i32, ptr %n, align 4
+  %divtmp43 = sdiv i32 %loadtmp42, 10
+  call void @print(i32 %divtmp43)
+  %loadtmp44 = load i32, ptr %p, align 4
+  %divtmp45 = sdiv i32 %loadtmp44, 641
+  call void @print(i32 %divtmp45)
+  %loadtmp46 = load i32, ptr %n, align 4
+  %divtmp47 = sdiv i32 %loadtmp46, 1
+  call void @print(i32 %divtmp47)
+  store i32 0, ptr %i, align 4
+  store i32 -50, ptr %n, align 4
+  br label %while.cond
+
+return:                                           ; preds = %while.end
+  %retload = load i32, ptr %ret, align 4
+  ret i32 %retload
+
+while.cond:                                       ; preds = %while.body, %entry
+  %loadtmp48 = load i32, ptr %i, align 4
+  %cmptmp = icmp slt i32 %loadtmp48, 100
+  br i1 %cmptmp, label %while.body, label %while.end
+
+while.body:                                       ; preds = %while.cond
+  %loadtmp49 = load i32, ptr %n, align 4
+  %divtmp50 = sdiv i32 %loadtmp49, 7
+  call void @print(i32 %divtmp50)
+  %loadtmp51 = load i32, ptr %n, align 4
+  %divtmp52 = sdiv i32 %loadtmp51, 8
+  call void @print(i32 %divtmp52)
+  store i32 -6, ptr %d, align 4
+  %loadtmp53 = load i32, ptr %n, align 4
+  %loadtmp54 = load i32, ptr %d, align 4
+  %divtmp55 = sdiv i32 %loadtmp53, %loadtmp54
+  call void @print(i32 %divtmp55)
+  store i32 -16, ptr %d, align 4
+  %loadtmp56 = load i32, ptr %n, align 4
+  %loadtmp57 = load i32, ptr %d, align 4
+  %divtmp58 = sdiv i32 %loadtmp56, %loadtmp57
+  call void @print(i32 %divtmp58)
+  %loadtmp59 = load i32, ptr %n, align 4
+  %addtmp = add i32 %loadtmp59, 1
+  store i32 %addtmp, ptr %n, align 4
+  %loadtmp60 = load i32, ptr %i, align 4
+  %addtmp61 = add i32 %loadtmp60, 1
+  store i32 %addtmp61, ptr %i, align 4
+  br label %while.cond
+
+while.end:                                        ; preds = %while.cond
+  %loadtmp62 = load i32, ptr %big, align 4
+  %divtmp63 = sdiv i32 %loadtmp62, 5
+  store i32 %divtmp63, ptr %ret, align 4
+  br label %return
+}
+
+attributes #0 = { "target-cpu"="sapphirerapids" "target-features"="-avx512pf,+tsxldtrk,+cx16,+sahf,-tbm,+avx512ifma,+sha,+crc32,-fma4,+vpclmulqdq,+prfchw,+bmi2,+cldemote,+fsgsbase,-ptwrite,+amx-tile,-uintr,+gfni,+popcnt,-widekl,+aes,+avx512bitalg,+movdiri,+xsaves,-avx512er,+avxvnni,+avx512fp16,+avx512vnni,+amx-bf16,+avx512vpopcntdq,-pconfig,+clwb,+avx512f,+xsavec,-clzero,+pku,+mmx,-lwp,+rdpid,-xop,+rdseed,-waitpkg,-kl,+movdir64b,-sse4a,+avx512bw,+clflushopt,+xsave,+avx512vbmi2,+64bit,+avx512vl,+serialize,-hreset,+invpcid,+avx512cd,+avx,+vaes,+avx512bf16,+cx8,+fma,-rtm,+bmi,-enqcmd,+rdrnd,-mwaitx,+sse4.1,+sse4.2,+avx2,+fxsr,+wbnoinvd,+sse,+lzcnt,+pclmul,-prefetchwt1,+f16c,+ssse3,-sgx,+shstk,+cmov,+avx512vbmi,+amx-int8,+movbe,-avx512vp2intersect,+xsaveopt,+avx512dq,+sse2,+adx,+sse3" }
@@ -0,0 +1,1227 @@
+; div_const_check.ll
+;
+; Differential test for divconst. Each @test* function divides a range of
+; dividends by one constant. divconst lowers those sdiv and srem; @compare*
+; divides by an argument, which it leaves alone, so the hardware divide
+; checks every lowered result. @main returns the number of divisors with a
+; wrong quotient or remainder, so 0 means success:
+;
+;   ./optimizer -passes=divconst -o div_const_check_opt.ll div_const_check.ll
+;   lli div_const_check_opt.ll
+;
+; The divisors cover every shape of the lowering, named above each test:
+; +-1, +-2^k, and magic multipliers M with and without the +-x correction,
+; with shift 0 and with negative d. Each divisor d is tried against MIN,
+; MIN+1, -1, 0, 1, MAX and k*d-1, k*d, k*d+1 for k in 1, 2, 3, -1, -2, -3,
+; MAX/d and MIN/d. A dividend that would overflow, and MIN for d = -1, is
+; replaced by 0. There are no pointers, so any LLVM version reads the file.
+
+; ---- i32 ----
+
+; %a<i>, for i in [0, 8)
+define i32 @element32(i32 %i, i32 %a0, i32 %a1, i32 %a2, i32 %a3, i32 %a4, i32 %a5, i32 %a6, i32 %a7) {
+  %is1 = icmp eq i32 %i, 1
+  %v1 = select i1 %is1, i32 %a1, i32 %a0
+  %is2 = icmp eq i32 %i, 2
+  %v2 = select i1 %is2, i32 %a2, i32 %v1
+  %is3 = icmp eq i32 %i, 3
+  %v3 = select i1 %is3, i32 %a3, i32 %v2
+  %is4 = icmp eq i32 %i, 4
+  %v4 = select i1 %is4, i32 %a4, i32 %v3
+  %is5 = icmp eq i32 %i, 5
+  %v5 = select i1 %is5, i32 %a5, i32 %v4
+  %is6 = icmp eq i32 %i, 6
+  %v6 = select i1 %is6, i32 %a6, i32 %v5
+  %is7 = icmp eq i32 %i, 7
+  %v7 = select i1 %is7, i32 %a7, i32 %v6
+  ret i32 %v7
+}
+
+; The i-th dividend tried against %d, for i in [0, 30)
+define i32 @dividend32(i32 %d, i32 %i) {
+entry:
+  %isMinusOne = icmp eq i32 %d, -1
+  %isEdge = icmp ult i32 %i, 6
+  br i1 %isEdge, label %edge, label %multiple
+
+edge:
+  %edgeValue = call i32 @element32(i32 %i, i32 -2147483648, i32 -2147483647, i32 -1, i32 0, i32 1, i32 2147483647, i32 0, i32 0)
+  br label %pick
+
+multiple:
+  %j = sub i32 %i, 6
+  %kIndex = udiv i32 %j, 3
+  %deltaIndex = urem i32 %j, 3
+  %delta = sub i32 %deltaIndex, 1
+  %safeD = select i1 %isMinusOne, i32 1, i32 %d
+  %kMax = sdiv i32 2147483647, %d
+  %kMin = sdiv i32 -2147483648, %safeD
+  %k = call i32 @element32(i32 %kIndex, i32 1, i32 2, i32 3, i32 -1, i32 -2, i32 -3, i32 %kMax, i32 %kMin)
+  %product = call { i32, i1 } @llvm.smul.with.overflow.i32(i32 %k, i32 %d)
+  %kd = extractvalue { i32, i1 } %product, 0
+  %mulOverflow = extractvalue { i32, i1 } %product, 1
+  %sum = call { i32, i1 } @llvm.sadd.with.overflow.i32(i32 %kd, i32 %delta)
+  %near = extractvalue { i32, i1 } %sum, 0
+  %addOverflow = extractvalue { i32, i1 } %sum, 1
+  %overflow = or i1 %mulOverflow, %addOverflow
+  %nearValue = select i1 %overflow, i32 0, i32 %near
+  br label %pick
+
+pick:
+  %x = phi i32 [ %edgeValue, %edge ], [ %nearValue, %multiple ]
+  %isMin = icmp eq i32 %x, -2147483648
+  %undefined = and i1 %isMin, %isMinusOne
+  %dividend = select i1 %undefined, i32 0, i32 %x
+  ret i32 %dividend
+}
+
+; 1 if %q and %r are not x / d and x % d
+define i32 @compare32(i32 %x, i32 %d, i32 %q, i32 %r) {
+  %expectQ = sdiv i32 %x, %d
+  %expectR = srem i32 %x, %d
+  %badQ = icmp ne i32 %q, %expectQ
+  %badR = icmp ne i32 %r, %expectR
+  %bad = or i1 %badQ, %badR
+  %result = zext i1 %bad to i32
+  ret i32 %result
+}
+
+; d = +-1
+define i32 @test32_1() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 1, i32 %i)
+  %q = sdiv i32 %x, 1
+  %r = srem i32 %x, 1
+  %bad = call i32 @compare32(i32 %x, i32 1, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; d = +-1
+define i32 @test32_m1() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 -1, i32 %i)
+  %q = sdiv i32 %x, -1
+  %r = srem i32 %x, -1
+  %bad = call i32 @compare32(i32 %x, i32 -1, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; d = +-2^k
+define i32 @test32_2() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 2, i32 %i)
+  %q = sdiv i32 %x, 2
+  %r = srem i32 %x, 2
+  %bad = call i32 @compare32(i32 %x, i32 2, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; d = +-2^k
+define i32 @test32_m2() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 -2, i32 %i)
+  %q = sdiv i32 %x, -2
+  %r = srem i32 %x, -2
+  %bad = call i32 @compare32(i32 %x, i32 -2, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; d = +-2^k
+define i32 @test32_8() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 8, i32 %i)
+  %q = sdiv i32 %x, 8
+  %r = srem i32 %x, 8
+  %bad = call i32 @compare32(i32 %x, i32 8, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; d = +-2^k
+define i32 @test32_m16() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 -16, i32 %i)
+  %q = sdiv i32 %x, -16
+  %r = srem i32 %x, -16
+  %bad = call i32 @compare32(i32 %x, i32 -16, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; d = +-2^k
+define i32 @test32_1024() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 1024, i32 %i)
+  %q = sdiv i32 %x, 1024
+  %r = srem i32 %x, 1024
+  %bad = call i32 @compare32(i32 %x, i32 1024, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; d = +-2^k
+define i32 @test32_1073741824() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 1073741824, i32 %i)
+  %q = sdiv i32 %x, 1073741824
+  %r = srem i32 %x, 1073741824
+  %bad = call i32 @compare32(i32 %x, i32 1073741824, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; d = +-2^k
+define i32 @test32_m1073741824() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 -1073741824, i32 %i)
+  %q = sdiv i32 %x, -1073741824
+  %r = srem i32 %x, -1073741824
+  %bad = call i32 @compare32(i32 %x, i32 -1073741824, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; d = +-2^k
+define i32 @test32_m2147483648() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 -2147483648, i32 %i)
+  %q = sdiv i32 %x, -2147483648
+  %r = srem i32 %x, -2147483648
+  %bad = call i32 @compare32(i32 %x, i32 -2147483648, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 0
+define i32 @test32_3() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 3, i32 %i)
+  %q = sdiv i32 %x, 3
+  %r = srem i32 %x, 3
+  %bad = call i32 @compare32(i32 %x, i32 3, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; negative d, magic M > 0 (subtracts x), shift 1
+define i32 @test32_m3() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 -3, i32 %i)
+  %q = sdiv i32 %x, -3
+  %r = srem i32 %x, -3
+  %bad = call i32 @compare32(i32 %x, i32 -3, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 1
+define i32 @test32_5() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 5, i32 %i)
+  %q = sdiv i32 %x, 5
+  %r = srem i32 %x, 5
+  %bad = call i32 @compare32(i32 %x, i32 5, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; negative d, magic M < 0, shift 1
+define i32 @test32_m5() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 -5, i32 %i)
+  %q = sdiv i32 %x, -5
+  %r = srem i32 %x, -5
+  %bad = call i32 @compare32(i32 %x, i32 -5, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 0
+define i32 @test32_6() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 6, i32 %i)
+  %q = sdiv i32 %x, 6
+  %r = srem i32 %x, 6
+  %bad = call i32 @compare32(i32 %x, i32 6, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M < 0 (adds x), shift 2
+define i32 @test32_7() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 7, i32 %i)
+  %q = sdiv i32 %x, 7
+  %r = srem i32 %x, 7
+  %bad = call i32 @compare32(i32 %x, i32 7, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; negative d, magic M > 0 (subtracts x), shift 2
+define i32 @test32_m7() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 -7, i32 %i)
+  %q = sdiv i32 %x, -7
+  %r = srem i32 %x, -7
+  %bad = call i32 @compare32(i32 %x, i32 -7, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 2
+define i32 @test32_10() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 10, i32 %i)
+  %q = sdiv i32 %x, 10
+  %r = srem i32 %x, 10
+  %bad = call i32 @compare32(i32 %x, i32 10, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 1
+define i32 @test32_11() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 11, i32 %i)
+  %q = sdiv i32 %x, 11
+  %r = srem i32 %x, 11
+  %bad = call i32 @compare32(i32 %x, i32 11, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; negative d, magic M < 0, shift 1
+define i32 @test32_m11() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 -11, i32 %i)
+  %q = sdiv i32 %x, -11
+  %r = srem i32 %x, -11
+  %bad = call i32 @compare32(i32 %x, i32 -11, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 3
+define i32 @test32_25() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 25, i32 %i)
+  %q = sdiv i32 %x, 25
+  %r = srem i32 %x, 25
+  %bad = call i32 @compare32(i32 %x, i32 25, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 3
+define i32 @test32_125() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 125, i32 %i)
+  %q = sdiv i32 %x, 125
+  %r = srem i32 %x, 125
+  %bad = call i32 @compare32(i32 %x, i32 125, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 0
+define i32 @test32_641() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 641, i32 %i)
+  %q = sdiv i32 %x, 641
+  %r = srem i32 %x, 641
+  %bad = call i32 @compare32(i32 %x, i32 641, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; negative d, magic M < 0, shift 0
+define i32 @test32_m641() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 -641, i32 %i)
+  %q = sdiv i32 %x, -641
+  %r = srem i32 %x, -641
+  %bad = call i32 @compare32(i32 %x, i32 -641, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 6
+define i32 @test32_1000() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 1000, i32 %i)
+  %q = sdiv i32 %x, 1000
+  %r = srem i32 %x, 1000
+  %bad = call i32 @compare32(i32 %x, i32 1000, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 15
+define i32 @test32_65537() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 65537, i32 %i)
+  %q = sdiv i32 %x, 65537
+  %r = srem i32 %x, 65537
+  %bad = call i32 @compare32(i32 %x, i32 65537, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 29
+define i32 @test32_2147483647() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 2147483647, i32 %i)
+  %q = sdiv i32 %x, 2147483647
+  %r = srem i32 %x, 2147483647
+  %bad = call i32 @compare32(i32 %x, i32 2147483647, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; negative d, magic M < 0, shift 29
+define i32 @test32_m2147483647() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i32 @dividend32(i32 -2147483647, i32 %i)
+  %q = sdiv i32 %x, -2147483647
+  %r = srem i32 %x, -2147483647
+  %bad = call i32 @compare32(i32 %x, i32 -2147483647, i32 %q, i32 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; ---- i64 ----
+
+; %a<i>, for i in [0, 8)
+define i64 @element64(i32 %i, i64 %a0, i64 %a1, i64 %a2, i64 %a3, i64 %a4, i64 %a5, i64 %a6, i64 %a7) {
+  %is1 = icmp eq i32 %i, 1
+  %v1 = select i1 %is1, i64 %a1, i64 %a0
+  %is2 = icmp eq i32 %i, 2
+  %v2 = select i1 %is2, i64 %a2, i64 %v1
+  %is3 = icmp eq i32 %i, 3
+  %v3 = select i1 %is3, i64 %a3, i64 %v2
+  %is4 = icmp eq i32 %i, 4
+  %v4 = select i1 %is4, i64 %a4, i64 %v3
+  %is5 = icmp eq i32 %i, 5
+  %v5 = select i1 %is5, i64 %a5, i64 %v4
+  %is6 = icmp eq i32 %i, 6
+  %v6 = select i1 %is6, i64 %a6, i64 %v5
+  %is7 = icmp eq i32 %i, 7
+  %v7 = select i1 %is7, i64 %a7, i64 %v6
+  ret i64 %v7
+}
+
+; The i-th dividend tried against %d, for i in [0, 30)
+define i64 @dividend64(i64 %d, i32 %i) {
+entry:
+  %isMinusOne = icmp eq i64 %d, -1
+  %isEdge = icmp ult i32 %i, 6
+  br i1 %isEdge, label %edge, label %multiple
+
+edge:
+  %edgeValue = call i64 @element64(i32 %i, i64 -9223372036854775808, i64 -9223372036854775807, i64 -1, i64 0, i64 1, i64 9223372036854775807, i64 0, i64 0)
+  br label %pick
+
+multiple:
+  %j = sub i32 %i, 6
+  %kIndex = udiv i32 %j, 3
+  %deltaIndex = urem i32 %j, 3
+  %delta32 = sub i32 %deltaIndex, 1
+  %delta = sext i32 %delta32 to i64
+  %safeD = select i1 %isMinusOne, i64 1, i64 %d
+  %kMax = sdiv i64 9223372036854775807, %d
+  %kMin = sdiv i64 -9223372036854775808, %safeD
+  %k = call i64 @element64(i32 %kIndex, i64 1, i64 2, i64 3, i64 -1, i64 -2, i64 -3, i64 %kMax, i64 %kMin)
+  %product = call { i64, i1 } @llvm.smul.with.overflow.i64(i64 %k, i64 %d)
+  %kd = extractvalue { i64, i1 } %product, 0
+  %mulOverflow = extractvalue { i64, i1 } %product, 1
+  %sum = call { i64, i1 } @llvm.sadd.with.overflow.i64(i64 %kd, i64 %delta)
+  %near = extractvalue { i64, i1 } %sum, 0
+  %addOverflow = extractvalue { i64, i1 } %sum, 1
+  %overflow = or i1 %mulOverflow, %addOverflow
+  %nearValue = select i1 %overflow, i64 0, i64 %near
+  br label %pick
+
+pick:
+  %x = phi i64 [ %edgeValue, %edge ], [ %nearValue, %multiple ]
+  %isMin = icmp eq i64 %x, -9223372036854775808
+  %undefined = and i1 %isMin, %isMinusOne
+  %dividend = select i1 %undefined, i64 0, i64 %x
+  ret i64 %dividend
+}
+
+; 1 if %q and %r are not x / d and x % d
+define i32 @compare64(i64 %x, i64 %d, i64 %q, i64 %r) {
+  %expectQ = sdiv i64 %x, %d
+  %expectR = srem i64 %x, %d
+  %badQ = icmp ne i64 %q, %expectQ
+  %badR = icmp ne i64 %r, %expectR
+  %bad = or i1 %badQ, %badR
+  %result = zext i1 %bad to i32
+  ret i32 %result
+}
+
+; d = +-1
+define i32 @test64_1() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 1, i32 %i)
+  %q = sdiv i64 %x, 1
+  %r = srem i64 %x, 1
+  %bad = call i32 @compare64(i64 %x, i64 1, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; d = +-1
+define i32 @test64_m1() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 -1, i32 %i)
+  %q = sdiv i64 %x, -1
+  %r = srem i64 %x, -1
+  %bad = call i32 @compare64(i64 %x, i64 -1, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; d = +-2^k
+define i32 @test64_2() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 2, i32 %i)
+  %q = sdiv i64 %x, 2
+  %r = srem i64 %x, 2
+  %bad = call i32 @compare64(i64 %x, i64 2, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; d = +-2^k
+define i32 @test64_m4() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 -4, i32 %i)
+  %q = sdiv i64 %x, -4
+  %r = srem i64 %x, -4
+  %bad = call i32 @compare64(i64 %x, i64 -4, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; d = +-2^k
+define i32 @test64_1099511627776() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 1099511627776, i32 %i)
+  %q = sdiv i64 %x, 1099511627776
+  %r = srem i64 %x, 1099511627776
+  %bad = call i32 @compare64(i64 %x, i64 1099511627776, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; d = +-2^k
+define i32 @test64_m4611686018427387904() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 -4611686018427387904, i32 %i)
+  %q = sdiv i64 %x, -4611686018427387904
+  %r = srem i64 %x, -4611686018427387904
+  %bad = call i32 @compare64(i64 %x, i64 -4611686018427387904, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; d = +-2^k
+define i32 @test64_m9223372036854775808() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 -9223372036854775808, i32 %i)
+  %q = sdiv i64 %x, -9223372036854775808
+  %r = srem i64 %x, -9223372036854775808
+  %bad = call i32 @compare64(i64 %x, i64 -9223372036854775808, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 0
+define i32 @test64_3() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 3, i32 %i)
+  %q = sdiv i64 %x, 3
+  %r = srem i64 %x, 3
+  %bad = call i32 @compare64(i64 %x, i64 3, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; negative d, magic M > 0 (subtracts x), shift 1
+define i32 @test64_m3() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 -3, i32 %i)
+  %q = sdiv i64 %x, -3
+  %r = srem i64 %x, -3
+  %bad = call i32 @compare64(i64 %x, i64 -3, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 1
+define i32 @test64_5() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 5, i32 %i)
+  %q = sdiv i64 %x, 5
+  %r = srem i64 %x, 5
+  %bad = call i32 @compare64(i64 %x, i64 5, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 1
+define i32 @test64_7() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 7, i32 %i)
+  %q = sdiv i64 %x, 7
+  %r = srem i64 %x, 7
+  %bad = call i32 @compare64(i64 %x, i64 7, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; negative d, magic M < 0, shift 1
+define i32 @test64_m7() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 -7, i32 %i)
+  %q = sdiv i64 %x, -7
+  %r = srem i64 %x, -7
+  %bad = call i32 @compare64(i64 %x, i64 -7, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 2
+define i32 @test64_10() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 10, i32 %i)
+  %q = sdiv i64 %x, 10
+  %r = srem i64 %x, 10
+  %bad = call i32 @compare64(i64 %x, i64 10, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 8
+define i32 @test64_641() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 641, i32 %i)
+  %q = sdiv i64 %x, 641
+  %r = srem i64 %x, 641
+  %bad = call i32 @compare64(i64 %x, i64 641, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M < 0 (adds x), shift 29
+define i32 @test64_1000000007() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 1000000007, i32 %i)
+  %q = sdiv i64 %x, 1000000007
+  %r = srem i64 %x, 1000000007
+  %bad = call i32 @compare64(i64 %x, i64 1000000007, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; negative d, magic M > 0 (subtracts x), shift 22
+define i32 @test64_m6700417() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 -6700417, i32 %i)
+  %q = sdiv i64 %x, -6700417
+  %r = srem i64 %x, -6700417
+  %bad = call i32 @compare64(i64 %x, i64 -6700417, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; magic M > 0, shift 61
+define i32 @test64_9223372036854775807() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 9223372036854775807, i32 %i)
+  %q = sdiv i64 %x, 9223372036854775807
+  %r = srem i64 %x, 9223372036854775807
+  %bad = call i32 @compare64(i64 %x, i64 9223372036854775807, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; negative d, magic M < 0, shift 61
+define i32 @test64_m9223372036854775807() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %failed = phi i32 [ 0, %entry ], [ %failedNext, %loop ]
+  %x = call i64 @dividend64(i64 -9223372036854775807, i32 %i)
+  %q = sdiv i64 %x, -9223372036854775807
+  %r = srem i64 %x, -9223372036854775807
+  %bad = call i32 @compare64(i64 %x, i64 -9223372036854775807, i64 %q, i64 %r)
+  %failedNext = or i32 %failed, %bad
+  %next = add i32 %i, 1
+  %more = icmp slt i32 %next, 30
+  br i1 %more, label %loop, label %done
+
+done:
+  ret i32 %failedNext
+}
+
+; ---- driver ----
+
+define i32 @main() {
+  %f0 = call i32 @test32_1()
+  %s0 = add i32 0, %f0
+  %f1 = call i32 @test32_m1()
+  %s1 = add i32 %s0, %f1
+  %f2 = call i32 @test32_2()
+  %s2 = add i32 %s1, %f2
+  %f3 = call i32 @test32_m2()
+  %s3 = add i32 %s2, %f3
+  %f4 = call i32 @test32_8()
+  %s4 = add i32 %s3, %f4
+  %f5 = call i32 @test32_m16()
+  %s5 = add i32 %s4, %f5
+  %f6 = call i32 @test32_1024()
+  %s6 = add i32 %s5, %f6
+  %f7 = call i32 @test32_1073741824()
+  %s7 = add i32 %s6, %f7
+  %f8 = call i32 @test32_m1073741824()
+  %s8 = add i32 %s7, %f8
+  %f9 = call i32 @test32_m2147483648()
+  %s9 = add i32 %s8, %f9
+  %f10 = call i32 @test32_3()
+  %s10 = add i32 %s9, %f10
+  %f11 = call i32 @test32_m3()
+  %s11 = add i32 %s10, %f11
+  %f12 = call i32 @test32_5()
+  %s12 = add i32 %s11, %f12
+  %f13 = call i32 @test32_m5()
+  %s13 = add i32 %s12, %f13
+  %f14 = call i32 @test32_6()
+  %s14 = add i32 %s13, %f14
+  %f15 = call i32 @test32_7()
+  %s15 = add i32 %s14, %f15
+  %f16 = call i32 @test32_m7()
+  %s16 = add i32 %s15, %f16
+  %f17 = call i32 @test32_10()
+  %s17 = add i32 %s16, %f17
+  %f18 = call i32 @test32_11()
+  %s18 = add i32 %s17, %f18
+  %f19 = call i32 @test32_m11()
+  %s19 = add i32 %s18, %f19
+  %f20 = call i32 @test32_25()
+  %s20 = add i32 %s19, %f20
+  %f21 = call i32 @test32_125()
+  %s21 = add i32 %s20, %f21
+  %f22 = call i32 @test32_641()
+  %s22 = add i32 %s21, %f22
+  %f23 = call i32 @test32_m641()
+  %s23 = add i32 %s22, %f23
+  %f24 = call i32 @test32_1000()
+  %s24 = add i32 %s23, %f24
+  %f25 = call i32 @test32_65537()
+  %s25 = add i32 %s24, %f25
+  %f26 = call i32 @test32_2147483647()
+  %s26 = add i32 %s25, %f26
+  %f27 = call i32 @test32_m2147483647()
+  %s27 = add i32 %s26, %f27
+  %f28 = call i32 @test64_1()
+  %s28 = add i32 %s27, %f28
+  %f29 = call i32 @test64_m1()
+  %s29 = add i32 %s28, %f29
+  %f30 = call i32 @test64_2()
+  %s30 = add i32 %s29, %f30
+  %f31 = call i32 @test64_m4()
+  %s31 = add i32 %s30, %f31
+  %f32 = call i32 @test64_1099511627776()
+  %s32 = add i32 %s31, %f32
+  %f33 = call i32 @test64_m4611686018427387904()
+  %s33 = add i32 %s32, %f33
+  %f34 = call i32 @test64_m9223372036854775808()
+  %s34 = add i32 %s33, %f34
+  %f35 = call i32 @test64_3()
+  %s35 = add i32 %s34, %f35
+  %f36 = call i32 @test64_m3()
+  %s36 = add i32 %s35, %f36
+  %f37 = call i32 @test64_5()
+  %s37 = add i32 %s36, %f37
+  %f38 = call i32 @test64_7()
+  %s38 = add i32 %s37, %f38
+  %f39 = call i32 @test64_m7()
+  %s39 = add i32 %s38, %f39
+  %f40 = call i32 @test64_10()
+  %s40 = add i32 %s39, %f40
+  %f41 = call i32 @test64_641()
+  %s41 = add i32 %s40, %f41
+  %f42 = call i32 @test64_1000000007()
+  %s42 = add i32 %s41, %f42
+  %f43 = call i32 @test64_m6700417()
+  %s43 = add i32 %s42, %f43
+  %f44 = call i32 @test64_9223372036854775807()
+  %s44 = add i32 %s43, %f44
+  %f45 = call i32 @test64_m9223372036854775807()
+  %s45 = add i32 %s44, %f45
+  ret i32 %s45
+}
+
+declare { i32, i1 } @llvm.smul.with.overflow.i32(i32, i32)
+declare { i32, i1 } @llvm.sadd.with.overflow.i32(i32, i32)
+declare { i64, i1 } @llvm.smul.with.overflow.i64(i64, i64)
+declare { i64, i1 } @llvm.sadd.with.overflow.i64(i64, i64)
@@ -0,0 +1,101 @@
+; ModuleID = 'div_const.ll'
+source_filename = "minic_module"
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+
+declare void @print(i32)
+
+declare i32 @read()
+
+define i32 @func(i32 %0) #0 {
+entry:
+  call void @print(i32 715827882)
+  call void @print(i32 306783378)
+  call void @print(i32 2097151)
+  call void @print(i32 1)
+  call void @print(i32 -715827882)
+  call void @print(i32 -306783378)
+  call void @print(i32 -1073741824)
+  call void @print(i32 -2097152)
+  call void @print(i32 -2)
+  call void @print(i32 -1)
+  call void @print(i32 -306783378)
+  call void @print(i32 306783378)
+  call void @print(i32 0)
+  call void @print(i32 1)
+  %subtmp37 = sub i32 0, %0
+  %div.wide = sext i32 %0 to i64
+  %div.product = mul i64 %div.wide, 1431655766
+  %div.high = ashr i64 %div.product, 32
+  %div.mulhs = trunc i64 %div.high to i32
+  %div.round = lshr i32 %div.mulhs, 31
+  %divtmp39 = add i32 %div.mulhs, %div.round
+  call void @print(i32 %divtmp39)
+  %div.wide1 = sext i32 %subtmp37 to i64
+  %div.product2 = mul i64 %div.wide1, 1431655766
+  %div.high3 = ashr i64 %div.product2, 32
+  %div.mulhs4 = trunc i64 %div.high3 to i32
+  %div.round5 = lshr i32 %div.mulhs4, 31
+  %divtmp41 = add i32 %div.mulhs4, %div.round5
+  call void @print(i32 %divtmp41)
+  %div.wide6 = sext i32 %subtmp37 to i64
+  %div.product7 = mul i64 %div.wide6, 1717986919
+  %div.high8 = ashr i64 %div.product7, 32
+  %div.mulhs9 = trunc i64 %div.high8 to i32
+  %div.shift = ashr i32 %div.mulhs9, 2
+  %div.round10 = lshr i32 %div.shift, 31
+  %divtmp43 = add i32 %div.shift, %div.round10
+  call void @print(i32 %divtmp43)
+  %div.wide11 = sext i32 %0 to i64
+  %div.product12 = mul i64 %div.wide11, 6700417
+  %div.high13 = ashr i64 %div.product12, 32
+  %div.mulhs14 = trunc i64 %div.high13 to i32
+  %div.round15 = lshr i32 %div.mulhs14, 31
+  %divtmp45 = add i32 %div.mulhs14, %div.round15
+  call void @print(i32 %divtmp45)
+  call void @print(i32 %subtmp37)
+  br label %while.cond
+
+while.cond:                                       ; preds = %while.body, %entry
+  %n.0 = phi i32 [ -50, %entry ], [ %addtmp, %while.body ]
+  %i.0 = phi i32 [ 0, %entry ], [ %addtmp61, %while.body ]
+  %cmptmp = icmp slt i32 %i.0, 100
+  br i1 %cmptmp, label %while.body, label %while.end
+
+while.body:                                       ; preds = %while.cond
+  %div.wide16 = sext i32 %n.0 to i64
+  %div.product17 = mul i64 %div.wide16, -1840700269
+  %div.high18 = ashr i64 %div.product17, 32
+  %div.mulhs19 = trunc i64 %div.high18 to i32
+  %div.fix = add i32 %div.mulhs19, %n.0
+  %div.shift20 = ashr i32 %div.fix, 2
+  %div.round21 = lshr i32 %div.shift20, 31
+  %divtmp50 = add i32 %div.shift20, %div.round21
+  call void @print(i32 %divtmp50)
+  %div.sign = ashr i32 %n.0, 2
+  %div.bias = lshr i32 %div.sign, 29
+  %div.biased = add i32 %n.0, %div.bias
+  %divtmp52 = ashr i32 %div.biased, 3
+  call void @print(i32 %divtmp52)
+  %div.wide22 = sext i32 %n.0 to i64
+  %div.product23 = mul i64 %div.wide22, -715827883
+  %div.high24 = ashr i64 %div.product23, 32
+  %div.mulhs25 = trunc i64 %div.high24 to i32
+  %div.round26 = lshr i32 %div.mulhs25, 31
+  %divtmp55 = add i32 %div.mulhs25, %div.round26
+  call void @print(i32 %divtmp55)
+  %div.sign27 = ashr i32 %n.0, 3
+  %div.bias28 = lshr i32 %div.sign27, 28
+  %div.biased29 = add i32 %n.0, %div.bias28
+  %div.q = ashr i32 %div.biased29, 4
+  %divtmp58 = sub i32 0, %div.q
+  call void @print(i32 %divtmp58)
+  %addtmp = add i32 %n.0, 1
+  %addtmp61 = add i32 %i.0, 1
+  br label %while.cond
+
+while.end:                                        ; preds = %while.cond
+  ret i32 429496729
+}
+
+attributes #0 = { "target-cpu"="sapphirerapids" "target-features"="-avx512pf,+tsxldtrk,+cx16,+sahf,-tbm,+avx512ifma,+sha,+crc32,-fma4,+vpclmulqdq,+prfchw,+bmi2,+cldemote,+fsgsbase,-ptwrite,+amx-tile,-uintr,+gfni,+popcnt,-widekl,+aes,+avx512bitalg,+movdiri,+xsaves,-avx512er,+avxvnni,+avx512fp16,+avx512vnni,+amx-bf16,+avx512vpopcntdq,-pconfig,+clwb,+avx512f,+xsavec,-clzero,+pku,+mmx,-lwp,+rdpid,-xop,+rdseed,-waitpkg,-kl,+movdir64b,-sse4a,+avx512bw,+clflushopt,+xsave,+avx512vbmi2,+64bit,+avx512vl,+serialize,-hreset,+invpcid,+avx512cd,+avx,+vaes,+avx512bf16,+cx8,+fma,-rtm,+bmi,-enqcmd,+rdrnd,-mwaitx,+sse4.1,+sse4.2,+avx2,+fxsr,+wbnoinvd,+sse,+lzcnt,+pclmul,-prefetchwt1,+f16c,+ssse3,-sgx,+shstk,+cmov,+avx512vbmi,+amx-int8,+movbe,-avx512vp2intersect,+xsaveopt,+avx512dq,+sse2,+adx,+sse3" }
@@ -5,45 +5,19 @@ target triple = "x86_64-pc-linux-gnu"
 
 ; Function Attrs: noinline nounwind optnone uwtable
 define dso_local i32 @func(i32 noundef %0) #0 {
-  %2 = alloca i32, align 4
-  %3 = alloca i32, align 4
-  %4 = alloca i32, align 4
-  %5 = alloca i32, align 4
-  store i32 %0, ptr %2, align 4
-  store i32 10, ptr %3, align 4
-  store i32 15, ptr %4, align 4
-  store i32 25, ptr %5, align 4
-  store i32 5, ptr %3, align 4
-  br label %6
+  br label %2
 
-6:                                                ; preds = %17, %1
-  %7 = load i32, ptr %3, align 4
-  %8 = load i32, ptr %2, align 4
-  %9 = icmp slt i32 %7, %8
-  br i1 %9, label %10, label %18
+2:                                                ; preds = %4, %1
+  %.0 = phi i32 [ 5, %1 ], [ %5, %4 ]
+  %3 = icmp slt i32 %.0, %0
+  br i1 %3, label %4, label %6
 
-10:                                               ; preds = %6
-  %11 = load i32, ptr %3, align 4
-  %12 = add nsw i32 %11, 1
-  store i32 %12, ptr %3, align 4
-  %13 = load i32, ptr %3, align 4
-  %14 = icmp sgt i32 %13, 15
-  br i1 %14, label %15, label %16
+4:                                                ; preds = %2
+  %5 = add nsw i32 %.0, 1
+  br label %2
 
-15:                                               ; preds = %10
-  store i32 25, ptr %5, align 4
-  br label %17
-
-16:                                               ; preds = %10
-  store i32 25, ptr %5, align 4
-  br label %17
-
-17:                                               ; preds = %16, %15
-  br label %6, !llvm.loop !6
-
-18:                                               ; preds = %6
-  %19 = load i32, ptr %3, align 4
-  call void @print(i32 noundef %19)
+6:                                                ; preds = %2
+  call void @print(i32 noundef %.0)
   call void @print(i32 noundef 15)
   call void @print(i32 noundef 25)
   ret i32 40
@@ -63,5 +37,3 @@ attributes #1 = { "frame-pointer"="all" "no-trapping-math"="true" "stack-protect
 !3 = !{i32 7, !"uwtable", i32 2}
 !4 = !{i32 7, !"frame-pointer", i32 2}
 !5 = !{!"Ubuntu clang version 15.0.7"}
-!6 = distinct !{!6, !7}
-!7 = !{!"llvm.loop.mustprogress"}
@@ -0,0 +1,103 @@
+; parallel_debug_info.ll
+;
+; Several functions with debug info, a lexical block, loop metadata and
+; locations inlined from another function. make check-parallel optimizes it
+; with and without -j; the two outputs must be the same.
+
+source_filename = "parallel_debug_info.c"
+
+define dso_local i32 @square(i32 noundef %x) !dbg !10 {
+  %1 = alloca i32, align 4
+  store i32 %x, ptr %1, align 4
+  call void @llvm.dbg.declare(metadata ptr %1, metadata !15, metadata !DIExpression()), !dbg !16
+  %2 = load i32, ptr %1, align 4, !dbg !17
+  %3 = load i32, ptr %1, align 4, !dbg !17
+  %4 = mul nsw i32 %2, %3, !dbg !17
+  ret i32 %4, !dbg !17
+}
+
+define dso_local i32 @sum(i32 noundef %n) !dbg !20 {
+  %1 = alloca i32, align 4
+  %2 = alloca i32, align 4
+  %3 = alloca i32, align 4
+  store i32 %n, ptr %1, align 4
+  call void @llvm.dbg.declare(metadata ptr %1, metadata !22, metadata !DIExpression()), !dbg !23
+  call void @llvm.dbg.declare(metadata ptr %2, metadata !24, metadata !DIExpression()), !dbg !25
+  store i32 0, ptr %2, align 4, !dbg !25
+  call void @llvm.dbg.declare(metadata ptr %3, metadata !26, metadata !DIExpression()), !dbg !28
+  store i32 0, ptr %3, align 4, !dbg !28
+  br label %4, !dbg !28
+
+4:
+  %5 = load i32, ptr %3, align 4, !dbg !29
+  %6 = load i32, ptr %1, align 4, !dbg !29
+  %7 = icmp slt i32 %5, %6, !dbg !29
+  br i1 %7, label %8, label %15, !dbg !29
+
+8:
+  %9 = load i32, ptr %3, align 4, !dbg !30
+  %10 = mul nsw i32 %9, %9, !dbg !31
+  %11 = load i32, ptr %2, align 4, !dbg !30
+  %12 = add nsw i32 %11, %10, !dbg !30
+  store i32 %12, ptr %2, align 4, !dbg !30
+  %13 = load i32, ptr %3, align 4, !dbg !29
+  %14 = add nsw i32 %13, 1, !dbg !29
+  store i32 %14, ptr %3, align 4, !dbg !29
+  br label %4, !dbg !29, !llvm.loop !32
+
+15:
+  %16 = load i32, ptr %2, align 4, !dbg !34
+  ret i32 %16, !dbg !34
+}
+
+define dso_local i32 @main() !dbg !40 {
+  %1 = alloca i32, align 4
+  call void @llvm.dbg.declare(metadata ptr %1, metadata !42, metadata !DIExpression()), !dbg !43
+  %2 = call i32 @sum(i32 noundef 4), !dbg !43
+  store i32 %2, ptr %1, align 4, !dbg !43
+  %3 = load i32, ptr %1, align 4, !dbg !44
+  %4 = mul nsw i32 3, 3, !dbg !45
+  %5 = add nsw i32 %3, %4, !dbg !44
+  ret i32 %5, !dbg !44
+}
+
+declare void @llvm.dbg.declare(metadata, metadata, metadata)
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!2, !3}
+!llvm.ident = !{!4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, splitDebugInlining: false, nameTableKind: None)
+!1 = !DIFile(filename: "parallel_debug_info.c", directory: "/tmp")
+!2 = !{i32 7, !"Dwarf Version", i32 5}
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = !{!"clang"}
+!5 = !DIBasicType(name: "int", size: 32, encoding: DW_ATE_signed)
+!6 = !DISubroutineType(types: !7)
+!7 = !{!5, !5}
+!8 = !DISubroutineType(types: !9)
+!9 = !{!5}
+!10 = distinct !DISubprogram(name: "square", scope: !1, file: !1, line: 1, type: !6, scopeLine: 1, flags: DIFlagPrototyped, spFlags: DISPFlagDefinition, unit: !0, retainedNodes: !11)
+!11 = !{}
+!15 = !DILocalVariable(name: "x", arg: 1, scope: !10, file: !1, line: 1, type: !5)
+!16 = !DILocation(line: 1, column: 16, scope: !10)
+!17 = !DILocation(line: 1, column: 28, scope: !10)
+!20 = distinct !DISubprogram(name: "sum", scope: !1, file: !1, line: 3, type: !6, scopeLine: 3, flags: DIFlagPrototyped, spFlags: DISPFlagDefinition, unit: !0, retainedNodes: !11)
+!22 = !DILocalVariable(name: "n", arg: 1, scope: !20, file: !1, line: 3, type: !5)
+!23 = !DILocation(line: 3, column: 13, scope: !20)
+!24 = !DILocalVariable(name: "total", scope: !20, file: !1, line: 4, type: !5)
+!25 = !DILocation(line: 4, column: 7, scope: !20)
+!26 = !DILocalVariable(name: "i", scope: !27, file: !1, line: 5, type: !5)
+!27 = distinct !DILexicalBlock(scope: !20, file: !1, line: 5, column: 3)
+!28 = !DILocation(line: 5, column: 12, scope: !27)
+!29 = !DILocation(line: 5, column: 19, scope: !27)
+!30 = !DILocation(line: 6, column: 11, scope: !27)
+!31 = !DILocation(line: 1, column: 28, scope: !10, inlinedAt: !30)
+!32 = distinct !{!32, !28, !33}
+!33 = !{!"llvm.loop.mustprogress"}
+!34 = !DILocation(line: 7, column: 3, scope: !20)
+!40 = distinct !DISubprogram(name: "main", scope: !1, file: !1, line: 10, type: !8, scopeLine: 10, spFlags: DISPFlagDefinition, unit: !0, retainedNodes: !11)
+!42 = !DILocalVariable(name: "s", scope: !40, file: !1, line: 11, type: !5)
+!43 = !DILocation(line: 11, column: 7, scope: !40)
+!44 = !DILocation(line: 12, column: 10, scope: !40)
+!45 = !DILocation(line: 1, column: 28, scope: !10, inlinedAt: !44)
@@ -0,0 +1,67 @@
+; ModuleID = 'opt_tests/parallel_debug_info.ll'
+source_filename = "parallel_debug_info.c"
+
+define dso_local i32 @square(i32 noundef %x) !dbg !5 {
+  %1 = mul nsw i32 %x, %x, !dbg !10
+  ret i32 %1, !dbg !10
+}
+
+define dso_local i32 @sum(i32 noundef %n) !dbg !11 {
+  br label %1, !dbg !12
+
+1:                                                ; preds = %3, %0
+  %.0 = phi i32 [ 0, %0 ], [ %5, %3 ]
+  %.01 = phi i32 [ 0, %0 ], [ %6, %3 ]
+  %2 = icmp slt i32 %.01, %n, !dbg !14
+  br i1 %2, label %3, label %7, !dbg !14
+
+3:                                                ; preds = %1
+  %4 = mul nsw i32 %.01, %.01, !dbg !15
+  %5 = add nsw i32 %.0, %4, !dbg !16
+  %6 = add nsw i32 %.01, 1, !dbg !14
+  br label %1, !dbg !14, !llvm.loop !17
+
+7:                                                ; preds = %1
+  ret i32 %.0, !dbg !19
+}
+
+define dso_local i32 @main() !dbg !20 {
+  %1 = call i32 @sum(i32 noundef 4), !dbg !23
+  %2 = add nsw i32 %1, 9, !dbg !24
+  ret i32 %2, !dbg !24
+}
+
+; Function Attrs: nofree nosync nounwind readnone speculatable willreturn
+declare void @llvm.dbg.declare(metadata, metadata, metadata) #0
+
+attributes #0 = { nofree nosync nounwind readnone speculatable willreturn }
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!2, !3}
+!llvm.ident = !{!4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, splitDebugInlining: false, nameTableKind: None)
+!1 = !DIFile(filename: "parallel_debug_info.c", directory: "/tmp")
+!2 = !{i32 7, !"Dwarf Version", i32 5}
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = !{!"clang"}
+!5 = distinct !DISubprogram(name: "square", scope: !1, file: !1, line: 1, type: !6, scopeLine: 1, flags: DIFlagPrototyped, spFlags: DISPFlagDefinition, unit: !0, retainedNodes: !9)
+!6 = !DISubroutineType(types: !7)
+!7 = !{!8, !8}
+!8 = !DIBasicType(name: "int", size: 32, encoding: DW_ATE_signed)
+!9 = !{}
+!10 = !DILocation(line: 1, column: 28, scope: !5)
+!11 = distinct !DISubprogram(name: "sum", scope: !1, file: !1, line: 3, type: !6, scopeLine: 3, flags: DIFlagPrototyped, spFlags: DISPFlagDefinition, unit: !0, retainedNodes: !9)
+!12 = !DILocation(line: 5, column: 12, scope: !13)
+!13 = distinct !DILexicalBlock(scope: !11, file: !1, line: 5, column: 3)
+!14 = !DILocation(line: 5, column: 19, scope: !13)
+!15 = !DILocation(line: 1, column: 28, scope: !5, inlinedAt: !16)
+!16 = !DILocation(line: 6, column: 11, scope: !13)
+!17 = distinct !{!17, !12, !18}
+!18 = !{!"llvm.loop.mustprogress"}
+!19 = !DILocation(line: 7, column: 3, scope: !11)
+!20 = distinct !DISubprogram(name: "main", scope: !1, file: !1, line: 10, type: !21, scopeLine: 10, spFlags: DISPFlagDefinition, unit: !0, retainedNodes: !9)
+!21 = !DISubroutineType(types: !22)
+!22 = !{!8}
+!23 = !DILocation(line: 11, column: 7, scope: !20)
+!24 = !DILocation(line: 12, column: 10, scope: !20)
@@ -0,0 +1,334 @@
+/*
+ * parallelOptimizer.cpp
+ *
+ * Optimizes the functions of a module on several threads (-j N). An
+ * LLVMContext can only be used by one thread at a time, so the module is
+ * written to bitcode once and every worker loads it lazily into a context of
+ * its own, materializing only the functions it was given. Each worker runs
+ * the pass pipeline on those functions and writes them back as bitcode.
+ *
+ * The main thread then reads each result into the original context and moves
+ * the optimized bodies into the original functions. Functions never change
+ * position, so the output is the same for every -j value. Metadata read back
+ * from a worker (debug info, loop and alias metadata) is a second copy of the
+ * original's; the moved bodies are pointed back at the original nodes.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <llvm-c/Core.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+
+#include "passManager.h"
+
+using namespace llvm;
+
+/* Functions handled by one worker and what it produced. */
+struct Bucket {
+  std::vector<unsigned> functions;  // indices in module order
+  unsigned long long size = 0;      // instructions, for balancing
+  SmallVector<char, 0> bitcode;     // optimized module, or empty on failure
+  PassManager passManager;
+};
+
+/* Named metadata listing each function's subprogram in the bitcode sent to workers. */
+static const char* SUBPROGRAMS = "parallel.subprograms";
+
+/*
+ * Returns why function bodies cannot be moved between contexts by position,
+ * or nullptr if they can. Named struct types are renamed when read into a
+ * context that already has them, and block addresses name blocks that move.
+ */
+static const char* splitObstacle(const Module& M) {
+  if (!M.getIdentifiedStructTypes().empty()) return "the module has named struct types";
+
+  for (const Function& F : M) {
+    for (const BasicBlock& BB : F) {
+      if (BB.hasAddressTaken()) return "the module takes block addresses";
+    }
+  }
+  return nullptr;
+}
+
+/*
+ * Worker: loads `bitcode` into a fresh context, optimizes the bucket's
+ * functions and writes them (with declarations for everything else) back to
+ * bitcode.
+ */
+static void optimizeBucket(StringRef bitcode, Bucket& bucket) {
+  LLVMContext context;
+
+  Expected<std::unique_ptr<Module>> loaded =
+      getLazyBitcodeModule(MemoryBufferRef(bitcode, "split"), context);
+  if (!loaded) {
+    consumeError(loaded.takeError());
+    return;
+  }
+  Module& M = **loaded;
+
+  std::vector<Function*> functions;
+  for (Function& F : M) functions.push_back(&F);
+
+  std::vector<bool> mine(functions.size(), false);
+  for (unsigned i : bucket.functions) mine[i] = true;
+
+  // Bodies owned by other workers are never read
+  for (unsigned i = 0; i < functions.size(); i++) {
+    if (!mine[i] && !functions[i]->isDeclaration()) functions[i]->deleteBody();
+  }
+  if (Error err = M.materializeAll()) {
+    consumeError(std::move(err));
+    return;
+  }
+
+  for (unsigned i : bucket.functions) bucket.passManager.run(wrap(functions[i]));
+
+  raw_svector_ostream OS(bucket.bitcode);
+  WriteBitcodeToFile(M, OS);
+}
+
+/* Returns true if `result` has the same global values as `M`, so they correspond by position. */
+static bool sameShape(const Module& M, const Module& result) {
+  return M.size() == result.size() && M.global_size() == result.global_size() &&
+         M.alias_size() == result.alias_size() && M.ifunc_size() == result.ifunc_size();
+}
+
+/*
+ * Records in `map` that `from`, read back from a worker, is a copy of `to`,
+ * and pairs their operands the same way. Both were read from the same
+ * bitcode, so nodes reached along the same path correspond.
+ */
+static void pairMetadata(Metadata* from, Metadata* to, ValueToValueMapTy& map) {
+  SmallVector<std::pair<Metadata*, Metadata*>, 16> worklist = {{from, to}};
+  while (!worklist.empty()) {
+    std::pair<Metadata*, Metadata*> pair = worklist.pop_back_val();
+    MDNode* copy = dyn_cast_or_null<MDNode>(pair.first);
+    MDNode* original = dyn_cast_or_null<MDNode>(pair.second);
+    if (!copy || !original || copy == original) continue;
+    if (copy->getMetadataID() != original->getMetadataID()) continue;
+    if (copy->getNumOperands() != original->getNumOperands()) continue;
+    if (map.MD().count(copy)) continue;
+
+    map.MD()[copy].reset(original);
+    for (unsigned i = 0; i < copy->getNumOperands(); i++) {
+      worklist.push_back({copy->getOperand(i), original->getOperand(i)});
+    }
+  }
+}
+
+/*
+ * Maps the metadata `result` shares with `M` back to `M`'s nodes: named
+ * metadata, the attachments of global variables and functions, and the
+ * subprograms listed before the split. Everything reachable from these is
+ * paired too.
+ */
+static void pairModuleMetadata(Module& M, Module& result, ValueToValueMapTy& map) {
+  for (NamedMDNode& named : result.named_metadata()) {
+    NamedMDNode* original = M.getNamedMetadata(named.getName());
+    if (original == nullptr || original->getNumOperands() != named.getNumOperands()) continue;
+    for (unsigned i = 0; i < named.getNumOperands(); i++) {
+      pairMetadata(named.getOperand(i), original->getOperand(i), map);
+    }
+  }
+
+  SmallVector<std::pair<unsigned, MDNode*>, 4> copies, originals;
+  auto pairAttachments = [&](const GlobalObject& from, const GlobalObject& to) {
+    // getAllMetadata leaves the vectors alone when there are no attachments
+    copies.clear();
+    originals.clear();
+    from.getAllMetadata(copies);
+    to.getAllMetadata(originals);
+    for (unsigned i = 0; i < copies.size() && i < originals.size(); i++) {
+      if (copies[i].first == originals[i].first) pairMetadata(copies[i].second, originals[i].second, map);
+    }
+  };
+  auto variable = M.global_begin();
+  for (GlobalVariable& from : result.globals()) pairAttachments(from, *variable++);
+  auto function = M.begin();
+  for (Function& from : result) pairAttachments(from, *function++);
+
+  NamedMDNode* subprograms = result.getNamedMetadata(SUBPROGRAMS);
+  if (subprograms == nullptr || subprograms->getNumOperands() != M.size()) return;
+  unsigned i = 0;
+  for (Function& F : M) {
+    if (DISubprogram* subprogram = F.getSubprogram()) pairMetadata(subprograms->getOperand(i), subprogram, map);
+    i++;
+  }
+}
+
+/*
+ * Points the metadata used by the instructions of `F` at the nodes `map`
+ * pairs them with. Nodes without a pair belong to the moved body alone
+ * (lexical blocks, loop IDs) and are kept, with their operands remapped.
+ */
+static void remapMetadata(Function& F, ValueToValueMapTy& map) {
+  const RemapFlags flags = RF_IgnoreMissingLocals | RF_ReuseAndMutateDistinctMDs;
+  SmallVector<std::pair<unsigned, MDNode*>, 4> attachments;
+  for (BasicBlock& BB : F) {
+    for (Instruction& I : BB) {
+      attachments.clear();
+      I.getAllMetadata(attachments);
+      for (const auto& kindAndNode : attachments) {
+        I.setMetadata(kindAndNode.first, MapMetadata(kindAndNode.second, map, flags));
+      }
+
+      // Debug intrinsics take their variable and expression as operands
+      for (Use& operand : I.operands()) {
+        auto* wrapped = dyn_cast<MetadataAsValue>(operand.get());
+        if (wrapped == nullptr || !isa<MDNode>(wrapped->getMetadata())) continue;
+        operand.set(MetadataAsValue::get(F.getContext(), MapMetadata(wrapped->getMetadata(), map, flags)));
+      }
+    }
+  }
+}
+
+/*
+ * Moves the optimized bodies of `bucket` from `result` into `M`, which
+ * sameShape has accepted. References to `result`'s global values are
+ * pointed at `M`'s before any body moves, and its metadata at `M`'s after.
+ */
+static void mergeBucket(Module& M, Module& result, const Bucket& bucket) {
+  auto redirect = [](auto&& from, auto&& to) {
+    auto target = to.begin();
+    for (auto& value : from) {
+      value.replaceAllUsesWith(&*target);
+      ++target;
+    }
+  };
+  redirect(result.globals(), M.globals());
+  redirect(result.aliases(), M.aliases());
+  redirect(result.ifuncs(), M.ifuncs());
+
+  ValueToValueMapTy metadata;
+  pairModuleMetadata(M, result, metadata);
+
+  std::vector<Function*> original, optimized;
+  for (Function& F : M) original.push_back(&F);
+  for (Function& F : result) optimized.push_back(&F);
+  redirect(result.functions(), M.functions());
+
+  for (unsigned i : bucket.functions) {
+    Function* F = original[i];
+    Function* from = optimized[i];
+
+    // Drop the unoptimized body without touching linkage or attributes
+    for (BasicBlock& BB : *F) BB.dropAllReferences();
+    while (!F->empty()) F->begin()->eraseFromParent();
+
+    for (unsigned a = 0; a < F->arg_size(); a++) {
+      from->getArg(a)->replaceAllUsesWith(F->getArg(a));
+    }
+
+    while (!from->empty()) {
+      BasicBlock& BB = from->front();
+      BB.removeFromParent();
+      BB.insertInto(F);
+    }
+    remapMetadata(*F, metadata);
+  }
+}
+
+/* Tells the user why -j is not used and returns false. */
+static bool optimizeSerially(const char* reason) {
+  errs() << "Warning: -j ignored, " << reason << "; optimizing on one thread\n";
+  return false;
+}
+
+/*
+ * Runs `passManager`'s pipeline on every function of `module` using `jobs`
+ * threads and merges the per-thread statistics into `passManager`. Returns
+ * false without changing anything when the module cannot be split (with a
+ * warning unless it has fewer than two bodies); the caller then optimizes
+ * serially.
+ */
+bool optimizeInParallel(LLVMModuleRef module, unsigned jobs, PassManager& passManager) {
+  Module& M = *unwrap(module);
+  if (const char* obstacle = splitObstacle(M)) return optimizeSerially(obstacle);
+
+  // Largest functions first, each to the least loaded worker
+  std::vector<std::pair<unsigned long long, unsigned>> bySize;
+  unsigned index = 0;
+  for (Function& F : M) {
+    if (!F.isDeclaration()) bySize.push_back({F.getInstructionCount(), index});
+    index++;
+  }
+  if (bySize.size() < 2) return false;
+
+  std::stable_sort(bySize.begin(), bySize.end(),
+                   [](const std::pair<unsigned long long, unsigned>& a,
+                      const std::pair<unsigned long long, unsigned>& b) {
+                     return a.first > b.first;
+                   });
+
+  jobs = std::min<size_t>(jobs, bySize.size());
+  std::vector<std::unique_ptr<Bucket>> buckets;
+  for (unsigned w = 0; w < jobs; w++) {
+    buckets.emplace_back(new Bucket());
+    buckets.back()->passManager = passManager;
+    buckets.back()->passManager.clearStats();
+  }
+
+  for (const auto& sizeAndIndex : bySize) {
+    Bucket* least = buckets[0].get();
+    for (const auto& b : buckets) {
+      if (b->size < least->size) least = b.get();
+    }
+    least->functions.push_back(sizeAndIndex.second);
+    least->size += sizeAndIndex.first + 1;
+  }
+  for (const auto& b : buckets) std::sort(b->functions.begin(), b->functions.end());
+
+  // A worker drops the subprograms of the bodies it deletes, though code
+  // inlined from them still refers to them; list them for mergeBucket
+  NamedMDNode* subprograms = M.getOrInsertNamedMetadata(SUBPROGRAMS);
+  for (Function& F : M) {
+    MDNode* subprogram = F.getSubprogram();
+    subprograms->addOperand(subprogram ? subprogram : MDNode::get(M.getContext(), {}));
+  }
+
+  SmallVector<char, 0> bitcode;
+  raw_svector_ostream OS(bitcode);
+  WriteBitcodeToFile(M, OS);
+  M.eraseNamedMetadata(subprograms);
+  StringRef input(bitcode.data(), bitcode.size());
+
+  std::vector<std::thread> threads;
+  for (const auto& b : buckets) threads.emplace_back(optimizeBucket, input, std::ref(*b));
+  for (std::thread& t : threads) t.join();
+
+  // Read every result before changing M, so a failure leaves it untouched
+  std::vector<std::unique_ptr<Module>> results;
+  for (const auto& b : buckets) {
+    if (b->bitcode.empty()) return optimizeSerially("a worker could not read the module");
+
+    StringRef text(b->bitcode.data(), b->bitcode.size());
+    Expected<std::unique_ptr<Module>> parsed =
+        parseBitcodeFile(MemoryBufferRef(text, "optimized"), M.getContext());
+    if (!parsed) {
+      consumeError(parsed.takeError());
+      return optimizeSerially("a worker's result could not be read");
+    }
+    if (!sameShape(M, **parsed)) return optimizeSerially("a worker's result does not match the module");
+    results.push_back(std::move(*parsed));
+  }
+
+  for (unsigned w = 0; w < jobs; w++) {
+    mergeBucket(M, *results[w], *buckets[w]);
+    passManager.mergeStats(buckets[w]->passManager);
+  }
+
+  return true;
+}
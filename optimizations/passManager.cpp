@@ -0,0 +1,420 @@
+/*
+ * passManager.cpp
+ *
+ * Pipeline parsing, scheduling and statistics for the optimizer passes.
+ * New passes are added by listing them in passRegistry.
+ */
+
+#include "passManager.h"
+#include "analysisManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstdlib>
+
+#include <llvm/IR/Function.h>
+
+extern bool constantFolding(LLVMValueRef function);
+extern bool commonSubexpressionElimination(LLVMValueRef function);
+extern bool deadCodeElimination(LLVMValueRef function);
+extern bool aggressiveDeadCodeElimination(LLVMValueRef function);
+extern bool constantPropagation(LLVMValueRef function);
+extern bool copyPropagation(LLVMValueRef function);
+extern bool propagateConstants(LLVMValueRef function);
+extern bool promoteAllocas(LLVMValueRef function);
+extern bool globalValueNumbering(LLVMValueRef function);
+extern bool sparseConditionalPropagation(LLVMValueRef function);
+extern bool simplifyControlFlow(LLVMValueRef function);
+extern bool deadStoreElimination(LLVMValueRef function);
+extern bool peepholeSimplification(LLVMValueRef function);
+extern bool reassociateExpressions(LLVMValueRef function);
+extern bool lowerConstantDivision(LLVMValueRef function);
+
+thread_local PassCounters passCounters;
+
+struct PassInfo {
+  const char* name;
+  bool (*run)(LLVMValueRef function);
+  unsigned preserves;  // analyses still valid after the pass changes the function
+  bool global;         // solves dataflow over the CFG; skipped once out of budget
+};
+
+/*
+ * Every pass the pipeline can name. cp deletes loads, copyprop deletes
+ * loads and adds phis, and cf/dce/adce/prop/sccp/peephole/reassociate/
+ * divconst replace or delete side-effect free instructions. cse may rewrite a store's
+ * address operand, which changes which stores kill each other, and mem2reg
+ * and dse delete stores. gvn is treated like cse. A run that folds a branch or
+ * deletes a block (cf, sccp, simplifycfg) invalidates everything, whatever
+ * it declares.
+ */
+/* Rounds after which a fixpoint group that still changes something gives up. */
+static const unsigned MAX_FIXPOINT_ROUNDS = 100;
+
+static const PassInfo passRegistry[] = {
+  {"cp", constantPropagation, PreservesAll, true},
+  {"copyprop", copyPropagation, PreservesAll, true},
+  {"cf", constantFolding, PreservesAll, false},
+  {"dce", deadCodeElimination, PreservesAll, false},
+  {"adce", aggressiveDeadCodeElimination, PreservesAll, false},
+  {"cse", commonSubexpressionElimination,
+   AnalysisBlocks | AnalysisCFG | AnalysisStores, false},
+  {"prop", propagateConstants, PreservesAll, true},
+  {"mem2reg", promoteAllocas,
+   AnalysisBlocks | AnalysisCFG | AnalysisDominators | AnalysisFrontiers | AnalysisLoops, true},
+  {"gvn", globalValueNumbering,
+   AnalysisBlocks | AnalysisCFG | AnalysisDominators | AnalysisFrontiers | AnalysisLoops, true},
+  {"sccp", sparseConditionalPropagation, PreservesAll, true},
+  {"simplifycfg", simplifyControlFlow, PreservesNone, false},
+  {"dse", deadStoreElimination,
+   AnalysisBlocks | AnalysisCFG | AnalysisDominators | AnalysisFrontiers | AnalysisLoops, true},
+  {"peephole", peepholeSimplification, PreservesAll, false},
+  {"reassociate", reassociateExpressions, PreservesAll, false},
+  {"divconst", lowerConstantDivision, PreservesAll, false},
+};
+
+static const int numPasses = sizeof(passRegistry) / sizeof(passRegistry[0]);
+
+static int findPass(const std::string& name) {
+  for (int i = 0; i < numPasses; i++) {
+    if (name == passRegistry[i].name) return i;
+  }
+  return -1;
+}
+
+static unsigned long long countInstructions(LLVMValueRef function) {
+  return llvm::unwrap<llvm::Function>(function)->getInstructionCount();
+}
+
+static void addCounters(PassCounters& to, const PassCounters& after, const PassCounters& before) {
+  to.instructionsFolded += after.instructionsFolded - before.instructionsFolded;
+  to.loadsReplaced += after.loadsReplaced - before.loadsReplaced;
+  to.expressionsReused += after.expressionsReused - before.expressionsReused;
+  to.instructionsDeleted += after.instructionsDeleted - before.instructionsDeleted;
+  to.allocasPromoted += after.allocasPromoted - before.allocasPromoted;
+  to.branchesFolded += after.branchesFolded - before.branchesFolded;
+  to.blocksDeleted += after.blocksDeleted - before.blocksDeleted;
+  to.dataflowSweeps += after.dataflowSweeps - before.dataflowSweeps;
+}
+
+template <class Limit, class Used>
+static bool exceeds(Limit limit, Used used) {
+  return limit > 0 && used >= limit;
+}
+
+bool Budget::parse(const std::string& text, Budget& budget, std::string& error) {
+  budget = Budget();
+
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t end = text.find(',', pos);
+    if (end == std::string::npos) end = text.size();
+    std::string item = text.substr(pos, end - pos);
+    pos = end + 1;
+
+    size_t eq = item.find('=');
+    std::string key = item.substr(0, eq);
+    std::string value = eq == std::string::npos ? "" : item.substr(eq + 1);
+
+    char* rest = nullptr;
+    double number = value.empty() ? 0 : std::strtod(value.c_str(), &rest);
+    if (value.empty() || *rest != '\0' || number <= 0) {
+      error = "expected <limit>=<positive number>, got '" + item + "'";
+      return false;
+    }
+
+    if (key == "time") {
+      budget.milliseconds = number;
+    } else if (key == "iterations") {
+      budget.iterations = (unsigned long long)number;
+    } else if (key == "visits") {
+      budget.visits = (unsigned long long)number;
+    } else {
+      error = "unknown limit '" + key + "' (use time, iterations or visits)";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+std::string PassManager::presetPipeline(int level) {
+  switch (level) {
+    case 0: return "";
+    case 1: return "cf,cse,dce,simplifycfg";
+    case 2: return "simplifycfg,mem2reg,sccp,reassociate,peephole,divconst,gvn,dce,simplifycfg";
+    default: return "simplifycfg,mem2reg,fixpoint(sccp,reassociate,peephole,divconst,gvn,dce,simplifycfg)";
+  }
+}
+
+/*
+ * Recursive descent over: list := item (',' item)* ; item := name | 'fixpoint(' list ')'
+ */
+static bool parseList(const std::string& text, size_t& pos, std::vector<PassManager::Step>& out,
+                      std::string& error, int depth);
+
+bool PassManager::setPipeline(const std::string& text, std::string& error) {
+  std::string compact;
+  for (char c : text) {
+    if (!std::isspace((unsigned char)c)) compact += c;
+  }
+
+  std::vector<Step> steps;
+  size_t pos = 0;
+  if (!compact.empty()) {
+    if (!parseList(compact, pos, steps, error, 0)) return false;
+    if (pos != compact.size()) {
+      error = "unexpected '" + compact.substr(pos) + "' in pipeline";
+      return false;
+    }
+  }
+
+  pipelineText = compact;
+  pipeline = steps;
+  stats.assign(numPasses, PassStats());
+  return true;
+}
+
+static bool parseList(const std::string& text, size_t& pos, std::vector<PassManager::Step>& out,
+                      std::string& error, int depth) {
+  while (true) {
+    size_t start = pos;
+    while (pos < text.size() && text[pos] != ',' && text[pos] != '(' && text[pos] != ')') pos++;
+    std::string name = text.substr(start, pos - start);
+
+    PassManager::Step step;
+    if (pos < text.size() && text[pos] == '(') {
+      if (name != "fixpoint") {
+        error = "unknown group '" + name + "' (only fixpoint(...) is supported)";
+        return false;
+      }
+      pos++;
+      if (!parseList(text, pos, step.group, error, depth + 1)) return false;
+      if (pos >= text.size() || text[pos] != ')') {
+        error = "missing ')' after fixpoint group";
+        return false;
+      }
+      pos++;
+    } else {
+      step.pass = findPass(name);
+      if (step.pass < 0) {
+        error = "unknown pass '" + name + "'";
+        return false;
+      }
+    }
+    out.push_back(step);
+
+    if (pos < text.size() && text[pos] == ',') {
+      pos++;
+      continue;
+    }
+    if (pos < text.size() && text[pos] == ')' && depth == 0) {
+      error = "unmatched ')' in pipeline";
+      return false;
+    }
+    return true;
+  }
+}
+
+void PassManager::setBudgets(const Budget& perFunction, const Budget& perModule) {
+  functionBudget = perFunction;
+  moduleBudget = perModule;
+}
+
+void PassManager::startModule() {
+  moduleUsage = std::make_shared<ModuleUsage>();
+}
+
+void PassManager::charge(unsigned long long iterations, unsigned long long visits) {
+  if (!functionBudget.limited() && !moduleBudget.limited()) return;
+
+  usage.iterations += iterations;
+  usage.visits += visits;
+  moduleUsage->iterations += iterations;
+  moduleUsage->visits += visits;
+}
+
+/*
+ * Returns false once the function or module budget is used up; the first
+ * time, records the function and the limit it hit.
+ */
+bool PassManager::withinBudget(LLVMValueRef function) {
+  if (usage.exhausted) return false;
+  if (!functionBudget.limited() && !moduleBudget.limited()) return true;
+
+  auto now = std::chrono::steady_clock::now();
+  double functionMs = std::chrono::duration<double, std::milli>(now - usage.start).count();
+  double moduleMs = std::chrono::duration<double, std::milli>(now - moduleUsage->start).count();
+
+  const char* limit = nullptr;
+  if (exceeds(functionBudget.milliseconds, functionMs)) limit = "time";
+  else if (exceeds(functionBudget.iterations, usage.iterations)) limit = "iterations";
+  else if (exceeds(functionBudget.visits, usage.visits)) limit = "visits";
+  else if (exceeds(moduleBudget.milliseconds, moduleMs)) limit = "module time";
+  else if (exceeds(moduleBudget.iterations, moduleUsage->iterations.load())) limit = "module iterations";
+  else if (exceeds(moduleBudget.visits, moduleUsage->visits.load())) limit = "module visits";
+  if (limit == nullptr) return true;
+
+  exhaust(function, limit);
+  return false;
+}
+
+/* Records that `function` ran out of `limit`; later global passes are skipped. */
+void PassManager::exhaust(LLVMValueRef function, const char* limit) {
+  usage.exhausted = limit;
+  overBudget.push_back({llvm::unwrap<llvm::Function>(function)->getName().str(), limit});
+}
+
+bool PassManager::runPass(int pass, LLVMValueRef function) {
+  unsigned long long sweeps = passCounters.dataflowSweeps;
+  unsigned long long cfgEdits = passCounters.branchesFolded + passCounters.blocksDeleted;
+  bool changed = statsEnabled ? runPassWithStats(pass, function)
+                              : passRegistry[pass].run(function);
+
+  if (changed) {
+    bool cfgChanged = passCounters.branchesFolded + passCounters.blocksDeleted != cfgEdits;
+    analysesFor(function).invalidate(cfgChanged ? PreservesNone : passRegistry[pass].preserves);
+  }
+
+  bool countVisits = functionBudget.visits > 0 || moduleBudget.visits > 0;
+  charge(passCounters.dataflowSweeps - sweeps, countVisits ? countInstructions(function) : 0);
+  return changed;
+}
+
+bool PassManager::runPassWithStats(int pass, LLVMValueRef function) {
+  PassStats& s = stats[pass];
+  PassCounters before = passCounters;
+  s.instructionsBefore += countInstructions(function);
+
+  auto t0 = std::chrono::steady_clock::now();
+  bool changed = passRegistry[pass].run(function);
+  auto t1 = std::chrono::steady_clock::now();
+
+  s.seconds += std::chrono::duration<double>(t1 - t0).count();
+  s.instructionsAfter += countInstructions(function);
+  s.runs++;
+  if (changed) s.changedRuns++;
+  addCounters(s.counters, passCounters, before);
+  return changed;
+}
+
+bool PassManager::runSteps(const std::vector<Step>& steps, LLVMValueRef function) {
+  bool changed = false;
+
+  for (const Step& step : steps) {
+    if (step.pass >= 0) {
+      // Out of budget: keep the local cleanups only
+      if (passRegistry[step.pass].global && !withinBudget(function)) continue;
+      changed |= runPass(step.pass, function);
+      continue;
+    }
+
+    // Fixpoint group: repeat until a full round changes nothing, the
+    // budget runs out or the round limit is reached. The limit catches
+    // passes that keep undoing each other, and is reported like a budget.
+    unsigned rounds = 0;
+    while (runSteps(step.group, function)) {
+      changed = true;
+      charge(1, 0);
+      if (!withinBudget(function)) break;
+      if (++rounds == MAX_FIXPOINT_ROUNDS) {
+        exhaust(function, "fixpoint rounds");
+        break;
+      }
+    }
+  }
+
+  return changed;
+}
+
+void PassManager::run(LLVMValueRef function) {
+  if (stats.empty()) stats.assign(numPasses, PassStats());
+  functions++;
+  usage = FunctionUsage();
+  usage.start = std::chrono::steady_clock::now();
+  resetAnalyses();
+  runSteps(pipeline, function);
+  resetAnalyses();
+}
+
+void PassManager::mergeStats(const PassManager& other) {
+  if (stats.empty()) stats.assign(numPasses, PassStats());
+  functions += other.functions;
+  overBudget.insert(overBudget.end(), other.overBudget.begin(), other.overBudget.end());
+
+  for (size_t i = 0; i < other.stats.size(); i++) {
+    const PassStats& o = other.stats[i];
+    PassStats& s = stats[i];
+    s.runs += o.runs;
+    s.changedRuns += o.changedRuns;
+    s.instructionsBefore += o.instructionsBefore;
+    s.instructionsAfter += o.instructionsAfter;
+    s.seconds += o.seconds;
+    addCounters(s.counters, o.counters, PassCounters());
+  }
+}
+
+/* Returns `text` escaped for a JSON string: quotes, backslashes and control characters. */
+static std::string jsonEscape(const std::string& text) {
+  std::string escaped;
+  for (unsigned char c : text) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if (c < 0x20) {
+      char code[8];
+      std::snprintf(code, sizeof(code), "\\u%04x", c);
+      escaped += code;
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+void PassManager::writeStatsJSON(FILE* out) const {
+  std::fprintf(out, "{\n  \"pipeline\": \"%s\",\n  \"functions\": %llu,\n  \"passes\": [",
+               jsonEscape(pipelineText).c_str(), functions);
+
+  bool first = true;
+  for (size_t i = 0; i < stats.size(); i++) {
+    const PassStats& s = stats[i];
+    if (s.runs == 0) continue;
+
+    std::fprintf(out, "%s\n    {\"name\": \"%s\", \"runs\": %llu, \"changed_runs\": %llu, "
+                 "\"instructions_before\": %llu, \"instructions_after\": %llu, \"time_ms\": %.3f, "
+                 "\"instructions_folded\": %llu, \"loads_replaced\": %llu, "
+                 "\"expressions_reused\": %llu, \"instructions_deleted\": %llu, "
+                 "\"allocas_promoted\": %llu, \"branches_folded\": %llu, \"blocks_deleted\": %llu, "
+                 "\"dataflow_sweeps\": %llu}",
+                 first ? "" : ",", passRegistry[i].name, s.runs, s.changedRuns,
+                 s.instructionsBefore, s.instructionsAfter, s.seconds * 1000.0,
+                 s.counters.instructionsFolded, s.counters.loadsReplaced,
+                 s.counters.expressionsReused, s.counters.instructionsDeleted,
+                 s.counters.allocasPromoted, s.counters.branchesFolded, s.counters.blocksDeleted,
+                 s.counters.dataflowSweeps);
+    first = false;
+  }
+
+  std::fprintf(out, "%s],\n  \"over_budget\": [", first ? "" : "\n  ");
+
+  // Sorted so the report does not depend on which thread got which function
+  std::vector<std::pair<std::string, std::string>> sorted = overBudget;
+  std::sort(sorted.begin(), sorted.end());
+  for (size_t i = 0; i < sorted.size(); i++) {
+    std::fprintf(out, "%s\n    {\"function\": \"%s\", \"limit\": \"%s\"}", i ? "," : "",
+                 jsonEscape(sorted[i].first).c_str(), jsonEscape(sorted[i].second).c_str());
+  }
+  std::fprintf(out, "%s]\n}\n", overBudget.empty() ? "" : "\n  ");
+}
+
+void PassManager::writeBudgetReport(FILE* out) const {
+  std::vector<std::pair<std::string, std::string>> sorted = overBudget;
+  std::sort(sorted.begin(), sorted.end());
+
+  for (const auto& entry : sorted) {
+    std::fprintf(out, "Budget exhausted in %s (%s limit): global passes skipped\n",
+                 entry.first.c_str(), entry.second.c_str());
+  }
+}
@@ -0,0 +1,164 @@
+/*
+ * passManager.h
+ *
+ * Runs a configurable pipeline of optimizer passes over functions and
+ * collects per-pass statistics.
+ *
+ * A pipeline is a comma separated list of pass names. A group written as
+ * fixpoint(a,b,...) repeats its passes until none of them changes anything,
+ * for at most 100 rounds; a group that hits that limit is reported like a
+ * function that ran out of budget.
+ * Example: "fixpoint(cp,cf,dce),cse,dce". The worklist pass "prop" reaches
+ * the same result as fixpoint(cp,cf,dce); "sccp" finds at least as much and
+ * also deletes branches that are never taken. The presets run "mem2reg"
+ * (local variables to SSA registers), then sccp and "gvn" (cse across the
+ * dominator tree), with "simplifycfg" tidying blocks before and after;
+ * "reassociate" and "peephole" simplify the arithmetic sccp leaves, and
+ * "divconst" turns division by a constant into multiplies and shifts.
+ *
+ * Optional budgets bound the work spent per function and per module. Once a
+ * budget is used up, fixpoint groups stop repeating and global passes (those
+ * that solve dataflow over the whole CFG) are skipped, so the function still
+ * gets the local cleanups.
+ */
+
+#ifndef PASS_MANAGER_H
+#define PASS_MANAGER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <llvm-c/Core.h>
+
+/*
+ * Work counters bumped by the passes themselves. Thread-local so functions
+ * optimized on different threads do not race; the pass manager reads the
+ * difference around each pass run.
+ */
+struct PassCounters {
+  unsigned long long instructionsFolded = 0;
+  unsigned long long loadsReplaced = 0;
+  unsigned long long expressionsReused = 0;
+  unsigned long long instructionsDeleted = 0;
+  unsigned long long allocasPromoted = 0;
+  unsigned long long branchesFolded = 0;
+  unsigned long long blocksDeleted = 0;
+  unsigned long long dataflowSweeps = 0;  // bumped by the analyses
+};
+
+extern thread_local PassCounters passCounters;
+
+/*
+ * Work limits; 0 means unlimited. Iterations are fixpoint rounds plus
+ * dataflow sweeps. Instruction visits count the function's size once per
+ * pass run. Limits are checked between pass runs, so a budget can be
+ * overrun by at most one pass.
+ */
+struct Budget {
+  double milliseconds = 0;
+  unsigned long long iterations = 0;
+  unsigned long long visits = 0;
+
+  bool limited() const { return milliseconds > 0 || iterations > 0 || visits > 0; }
+
+  /* Parses "time=<ms>,iterations=<n>,visits=<n>" (any subset); on error
+   * returns false and describes the problem in `error`. */
+  static bool parse(const std::string& text, Budget& budget, std::string& error);
+};
+
+/* Accumulated statistics for one pass across all of its runs. */
+struct PassStats {
+  unsigned long long runs = 0;
+  unsigned long long changedRuns = 0;
+  unsigned long long instructionsBefore = 0;
+  unsigned long long instructionsAfter = 0;
+  double seconds = 0;
+  PassCounters counters;
+};
+
+class PassManager {
+public:
+  /* One pipeline element: a pass, or a fixpoint group of steps. */
+  struct Step {
+    int pass = -1;            // registry index, or -1 for a fixpoint group
+    std::vector<Step> group;  // steps of a fixpoint group
+  };
+
+  /* Pipeline text for optimization level 0-3. */
+  static std::string presetPipeline(int level);
+
+  /* Replaces the pipeline; on a syntax error or unknown pass returns false
+   * and describes the problem in `error`. */
+  bool setPipeline(const std::string& text, std::string& error);
+
+  /* Collect instruction counts and timings (costs one instruction walk
+   * per pass run). */
+  void enableStats() { statsEnabled = true; }
+
+  /* Runs the pipeline on one function with a body. */
+  void run(LLVMValueRef function);
+
+  /* Sets the per-function and per-module budgets. */
+  void setBudgets(const Budget& perFunction, const Budget& perModule);
+
+  /* Starts charging a new module. Copies made afterwards share its usage, so
+   * threads optimizing parts of one module draw on one module budget. */
+  void startModule();
+
+  /* Drops collected statistics; the pipeline is kept. */
+  void clearStats() {
+    stats.clear();
+    functions = 0;
+    overBudget.clear();
+  }
+
+  /* Adds another manager's statistics to this one. */
+  void mergeStats(const PassManager& other);
+
+  /* Writes the statistics as a JSON object. */
+  void writeStatsJSON(FILE* out) const;
+
+  /* Lists the functions that ran out of budget, one line each. */
+  void writeBudgetReport(FILE* out) const;
+
+private:
+  bool runSteps(const std::vector<Step>& steps, LLVMValueRef function);
+  bool runPass(int pass, LLVMValueRef function);
+  bool runPassWithStats(int pass, LLVMValueRef function);
+  void charge(unsigned long long iterations, unsigned long long visits);
+  bool withinBudget(LLVMValueRef function);
+  void exhaust(LLVMValueRef function, const char* limit);
+
+  /* Work done so far in the current module, shared between copies. */
+  struct ModuleUsage {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::atomic<unsigned long long> iterations{0};
+    std::atomic<unsigned long long> visits{0};
+  };
+
+  /* Work done so far in the function being optimized. */
+  struct FunctionUsage {
+    std::chrono::steady_clock::time_point start;
+    unsigned long long iterations = 0;
+    unsigned long long visits = 0;
+    const char* exhausted = nullptr;  // limit that ran out, if any
+  };
+
+  std::string pipelineText;
+  std::vector<Step> pipeline;
+  std::vector<PassStats> stats;
+  unsigned long long functions = 0;
+  bool statsEnabled = false;
+
+  Budget functionBudget;
+  Budget moduleBudget;
+  std::shared_ptr<ModuleUsage> moduleUsage = std::make_shared<ModuleUsage>();
+  FunctionUsage usage;
+  std::vector<std::pair<std::string, std::string>> overBudget;  // function, limit
+};
+
+#endif
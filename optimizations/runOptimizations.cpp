@@ -2,73 +2,393 @@
 * runOptimizations.cpp
  *
  * Loads an LLVM IR file, runs optimizations on each function,
- * and prints the optimized IR.
+ * and prints the optimized IR to stdout or to the file given with -o.
+ * Bitcode inputs are loaded lazily: each function is materialized only
+ * when it is optimized and its body is dropped once it has been written.
+ * With -j N the functions are optimized on N threads instead (see
+ * parallelOptimizer.cpp); the output is the same.
+ *
+ * Given several inputs and an output directory (-o), runs in batch mode:
+ * up to N files are loaded, optimized and written at once, each on its own
+ * thread with its own LLVMContext, and a summary is printed at the end.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <llvm-c/BitReader.h>
 #include <llvm-c/Core.h>
 #include <llvm-c/IRReader.h>
 #include <llvm-c/Support.h>
 
-extern bool constantFolding(LLVMValueRef function);
-extern bool commonSubexpressionElimination(LLVMValueRef function);
-extern bool deadCodeElimination(LLVMValueRef function);
-extern bool constantPropagation(LLVMValueRef function);
+#include "passManager.h"
 
-int main(int argc, char** argv) {
-    if (argc < 2) {
-        std::fprintf(stderr, "Usage: %s <input.ll>\n", argv[0]);
-        return 1;
-    }
+extern bool writeModule(LLVMModuleRef module, int fd, unsigned jobs);
+extern bool writeModuleLazily(LLVMModuleRef module, int fd, void (*optimize)(LLVMValueRef));
+extern bool optimizeInParallel(LLVMModuleRef module, unsigned jobs, PassManager& passManager);
 
-    const char* inputFile = argv[1];
+/* Pipeline selected on the command line (-O2 unless overridden). */
+static PassManager passManager;
 
-    LLVMContextRef context = LLVMContextCreate();
+/*
+ * Runs the optimization pipeline on one function.
+ */
+static void optimizeFunction(LLVMValueRef function) {
+    if (LLVMCountBasicBlocks(function) == 0) return;
+
+    passManager.run(function);
+}
+
+/*
+ * Print usage message.
+ */
+static void printUsage(const char* prog) {
+    std::fprintf(stderr,
+                 "Usage: %s [-O0|-O1|-O2|-O3] [-passes=<pipeline>] [-stats=<file.json>|-stats=-]\n"
+                 "          [-budget=<limits>] [-module-budget=<limits>]\n"
+                 "          [-j <threads>] [-o <output.ll>] <input.ll|input.bc>\n"
+                 "       %s [options] -o <output dir> <input>... (batch mode, writes <name>_opt.ll)\n"
+                 "  pipeline: comma separated passes (cp, copyprop, cf, dce, adce, dse, cse,\n"
+                 "            gvn, prop, sccp, mem2reg, simplifycfg, peephole, reassociate,\n"
+                 "            divconst);\n"
+                 "            fixpoint(...) repeats a group until nothing changes (at most\n"
+                 "            100 rounds, reported like a budget), e.g. mem2reg,sccp,gvn,dce\n"
+                 "  limits:   time=<ms>,iterations=<n>,visits=<n> (any subset); when one runs out,\n"
+                 "            global passes are skipped and the functions are reported\n",
+                 prog, prog);
+}
+
+/*
+ * Returns true if the buffer holds LLVM bitcode (raw or wrapped) rather than text.
+ */
+static bool isBitcode(LLVMMemoryBufferRef buffer) {
+    const unsigned char* p = (const unsigned char*)LLVMGetBufferStart(buffer);
+    size_t size = LLVMGetBufferSize(buffer);
+    if (size < 4) return false;
+
+    bool raw = p[0] == 'B' && p[1] == 'C' && p[2] == 0xC0 && p[3] == 0xDE;
+    bool wrapped = p[0] == 0xDE && p[1] == 0xC0 && p[2] == 0x17 && p[3] == 0x0B;
+    return raw || wrapped;
+}
+
+/*
+ * Reads `file` into a new module in `context`, or prints an error and
+ * returns nullptr. Bitcode is read lazily if `allowLazy` is set (`lazy` says
+ * whether it was); text is always parsed whole.
+ */
+static LLVMModuleRef loadModule(LLVMContextRef context, const char* file, bool allowLazy, bool& lazy) {
     LLVMMemoryBufferRef memoryBuffer = nullptr;
     LLVMModuleRef module = nullptr;
     char* errorMessage = nullptr;
+    lazy = false;
 
     // Load file into memory buffer
-    if (LLVMCreateMemoryBufferWithContentsOfFile(inputFile, &memoryBuffer, &errorMessage) != 0) {
-        std::fprintf(stderr, "Error reading file: %s\n", errorMessage);
-        return 1;
+    if (LLVMCreateMemoryBufferWithContentsOfFile(file, &memoryBuffer, &errorMessage) != 0) {
+        std::fprintf(stderr, "Error reading file %s: %s\n", file, errorMessage);
+        LLVMDisposeMessage(errorMessage);
+        return nullptr;
     }
 
-    // Parse IR into module
-    if (LLVMParseIRInContext(context, memoryBuffer, &module, &errorMessage) != 0) {
-        std::fprintf(stderr, "Error parsing IR: %s\n", errorMessage);
-        return 1;
+    if (!isBitcode(memoryBuffer)) {
+        if (LLVMParseIRInContext(context, memoryBuffer, &module, &errorMessage) != 0) {
+            std::fprintf(stderr, "Error parsing IR: %s\n", errorMessage);
+            LLVMDisposeMessage(errorMessage);
+            return nullptr;
+        }
+        return module;
     }
 
-    // Run local optimizations on each function
+    lazy = allowLazy;
+    LLVMBool failed = lazy ? LLVMGetBitcodeModuleInContext2(context, memoryBuffer, &module)
+                           : LLVMParseBitcodeInContext2(context, memoryBuffer, &module);
+    if (!lazy) LLVMDisposeMemoryBuffer(memoryBuffer);  // only the lazy reader keeps it
+    if (failed) {
+        std::fprintf(stderr, "Error reading bitcode: %s\n", file);
+        return nullptr;
+    }
+    return module;
+}
+
+/*
+ * Runs `pm`'s pipeline on every function with a body.
+ */
+static void optimizeModule(LLVMModuleRef module, PassManager& pm) {
     for (LLVMValueRef function = LLVMGetFirstFunction(module);
          function != nullptr;
          function = LLVMGetNextFunction(function)) {
+        if (LLVMCountBasicBlocks(function) == 0) continue;
+        pm.run(function);
+    }
+}
 
+/*
+ * Writes statistics as JSON to `statsFile` ("-" writes to stderr).
+ */
+static bool writeStats(const PassManager& pm, const char* statsFile) {
+    FILE* out = std::strcmp(statsFile, "-") == 0 ? stderr : std::fopen(statsFile, "w");
+    if (out == nullptr) {
+        std::fprintf(stderr, "Error opening stats file: %s\n", statsFile);
+        return false;
+    }
+    pm.writeStatsJSON(out);
+    if (out != stderr) std::fclose(out);
+    return true;
+}
+
+/* One input of a batch run and what happened to it. */
+struct BatchFile {
+    const char* input = nullptr;
+    std::string output;
+    bool ok = false;
+    unsigned long long functions = 0;
+    unsigned long long instructionsBefore = 0;
+    unsigned long long instructionsAfter = 0;
+};
+
+/*
+ * Counts functions with a body and their instructions.
+ */
+static void countModule(LLVMModuleRef module, unsigned long long& functions,
+                        unsigned long long& instructions) {
+    functions = 0;
+    instructions = 0;
+    for (LLVMValueRef function = LLVMGetFirstFunction(module);
+         function != nullptr;
+         function = LLVMGetNextFunction(function)) {
         if (LLVMCountBasicBlocks(function) == 0) continue;
+        functions++;
+        for (LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(function); bb; bb = LLVMGetNextBasicBlock(bb)) {
+            for (LLVMValueRef inst = LLVMGetFirstInstruction(bb); inst; inst = LLVMGetNextInstruction(inst)) {
+                instructions++;
+            }
+        }
+    }
+}
 
-        // Global fixpoint: constant propagation followed by constant folding
-        while (true) {
-            bool changed = false;
+/*
+ * Loads, optimizes and writes one batch input in a context of its own.
+ */
+static void optimizeFile(BatchFile& file, PassManager& pm) {
+    LLVMContextRef context = LLVMContextCreate();
+    bool lazy;
+    LLVMModuleRef module = loadModule(context, file.input, false, lazy);
+    if (module == nullptr) {
+        LLVMContextDispose(context);
+        return;
+    }
+
+    countModule(module, file.functions, file.instructionsBefore);
+    pm.startModule();
+    optimizeModule(module, pm);
+    countModule(module, file.functions, file.instructionsAfter);
 
-            changed |= constantPropagation(function);
-            changed |= constantFolding(function);
-            changed |= deadCodeElimination(function);
+    int fd = open(file.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::fprintf(stderr, "Error opening output file: %s\n", file.output.c_str());
+    } else {
+        // Files are already spread over the threads; print each on one
+        file.ok = writeModule(module, fd, 1);
+        close(fd);
+        if (!file.ok) std::fprintf(stderr, "Error writing optimized IR: %s\n", file.output.c_str());
+    }
 
-            if (!changed) break;
+    LLVMDisposeModule(module);
+    LLVMContextDispose(context);
+}
+
+/*
+ * Returns true if `path` names an existing directory.
+ */
+static bool isDirectory(const char* path) {
+    struct stat info;
+    return stat(path, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+/*
+ * Batch mode: optimizes `inputs` into the existing directory `outputDir` on
+ * `jobs` threads, then prints a summary and, if requested, the combined
+ * statistics. Returns the process exit status.
+ */
+static int runBatch(const std::vector<const char*>& inputs, const char* outputDir,
+                    unsigned jobs, const char* statsFile) {
+    // <dir>/<input name without extension>_opt.ll; names must not collide
+    std::vector<BatchFile> files(inputs.size());
+    std::set<std::string> outputs;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        std::string name = inputs[i];
+        size_t slash = name.find_last_of('/');
+        if (slash != std::string::npos) name = name.substr(slash + 1);
+        size_t dot = name.find_last_of('.');
+        if (dot != std::string::npos && dot > 0) name = name.substr(0, dot);
+
+        files[i].input = inputs[i];
+        files[i].output = std::string(outputDir) + "/" + name + "_opt.ll";
+        if (!outputs.insert(files[i].output).second) {
+            std::fprintf(stderr, "Error: inputs map to the same output file: %s\n",
+                         files[i].output.c_str());
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Each thread takes the next file and keeps its own statistics
+    jobs = std::max<size_t>(1, std::min<size_t>(jobs, files.size()));
+    std::vector<PassManager> managers(jobs, passManager);
+    std::atomic<size_t> next(0);
+    auto work = [&](unsigned w) {
+        for (size_t i = next++; i < files.size(); i = next++) optimizeFile(files[i], managers[w]);
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned w = 1; w < jobs; w++) threads.emplace_back(work, w);
+    work(0);
+    for (std::thread& t : threads) t.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const PassManager& pm : managers) passManager.mergeStats(pm);
+    passManager.writeBudgetReport(stderr);
+
+    size_t optimized = 0;
+    unsigned long long functions = 0, before = 0, after = 0;
+    for (const BatchFile& file : files) {
+        if (!file.ok) continue;
+        optimized++;
+        functions += file.functions;
+        before += file.instructionsBefore;
+        after += file.instructionsAfter;
+    }
+
+    std::fprintf(stderr, "Optimized %zu of %zu files (%llu functions, %llu -> %llu instructions) "
+                 "in %.2f s on %u threads\n",
+                 optimized, files.size(), functions, before, after, seconds, jobs);
+
+    if (statsFile != nullptr && !writeStats(passManager, statsFile)) return 1;
+    return optimized == files.size() ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    std::vector<const char*> inputs;
+    const char* outputFile = nullptr;
+    const char* statsFile = nullptr;
+    unsigned jobs = 0;  // -j; 0 optimizes on one thread and prints on every core
+    std::string pipeline = PassManager::presetPipeline(2);
+    std::string functionBudget, moduleBudget;
+    bool badArgument = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+            jobs = std::atoi(argv[++i]);
+        } else if (std::strncmp(argv[i], "-O", 2) == 0 && argv[i][2] >= '0' && argv[i][2] <= '3' && argv[i][3] == '\0') {
+            pipeline = PassManager::presetPipeline(argv[i][2] - '0');
+        } else if (std::strncmp(argv[i], "-passes=", 8) == 0) {
+            pipeline = argv[i] + 8;
+        } else if (std::strncmp(argv[i], "-stats=", 7) == 0) {
+            statsFile = argv[i] + 7;
+        } else if (std::strncmp(argv[i], "-budget=", 8) == 0) {
+            functionBudget = argv[i] + 8;
+        } else if (std::strncmp(argv[i], "-module-budget=", 15) == 0) {
+            moduleBudget = argv[i] + 15;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            badArgument = true;
+            break;
+        } else {
+            inputs.push_back(argv[i]);
         }
+    }
+
+    // Several inputs need an output directory
+    if (badArgument || inputs.empty() || (inputs.size() > 1 && outputFile == nullptr)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string pipelineError;
+    if (!passManager.setPipeline(pipeline, pipelineError)) {
+        std::fprintf(stderr, "Error in pipeline: %s\n", pipelineError.c_str());
+        return 1;
+    }
+    if (statsFile != nullptr) passManager.enableStats();
+
+    Budget perFunction, perModule;
+    std::string budgetError;
+    if (!Budget::parse(functionBudget, perFunction, budgetError) ||
+        !Budget::parse(moduleBudget, perModule, budgetError)) {
+        std::fprintf(stderr, "Error in budget: %s\n", budgetError.c_str());
+        return 1;
+    }
+    passManager.setBudgets(perFunction, perModule);
+
+    // -o naming a directory selects batch mode, even for one input; several
+    // inputs create the directory if it is missing
+    bool batch = outputFile != nullptr && isDirectory(outputFile);
+    if (inputs.size() > 1 && !batch) {
+        if (mkdir(outputFile, 0755) != 0) {
+            std::fprintf(stderr, "Error creating output directory: %s\n", outputFile);
+            return 1;
+        }
+        batch = true;
+    }
+    if (batch) return runBatch(inputs, outputFile, jobs, statsFile);
+
+    // Bitcode is read lazily (function bodies stay unparsed) unless the module
+    // is split across threads
+    LLVMContextRef context = LLVMContextCreate();
+    bool lazy;
+    LLVMModuleRef module = loadModule(context, inputs[0], jobs <= 1, lazy);
+    if (module == nullptr) return 1;
+
+    // Optimized module goes to stdout or the -o file
+    int fd = STDOUT_FILENO;
+    if (outputFile != nullptr) {
+        fd = open(outputFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            std::fprintf(stderr, "Error opening output file: %s\n", outputFile);
+            return 1;
+        }
+    }
+
+    bool written;
+    passManager.startModule();
+    if (lazy) {
+        // Materialize, optimize, write and release one function at a time
+        written = writeModuleLazily(module, fd, optimizeFunction);
+    } else {
+        // Run optimizations on each function, then stream the module out.
+        // Modules that cannot be split are optimized on this thread.
+        if (jobs <= 1 || !optimizeInParallel(module, jobs, passManager)) {
+            optimizeModule(module, passManager);
+        }
+
+        written = writeModule(module, fd, jobs);
+    }
+
+    if (outputFile != nullptr) close(fd);
+
+    if (!written) {
+        std::fprintf(stderr, "Error writing optimized IR\n");
+        return 1;
+    }
 
-        // Local cleanup
-        commonSubexpressionElimination(function);
-        deadCodeElimination(function);
-         }
+    passManager.writeBudgetReport(stderr);
 
-    // Print optimized module
-    char* output = LLVMPrintModuleToString(module);
-    std::printf("%s", output);
-    LLVMDisposeMessage(output);
+    // Per-pass statistics as JSON
+    if (statsFile != nullptr && !writeStats(passManager, statsFile)) return 1;
 
     LLVMDisposeModule(module);
     LLVMContextDispose(context);
@@ -0,0 +1,361 @@
+/*
+ * sparseConditionalPropagation.cpp
+ *
+ * Sparse conditional constant propagation ("sccp" in pipelines), after Wegman
+ * and Zadeck. Every integer value starts out unknown and every CFG edge not
+ * taken. Values are only lowered (unknown -> constant -> overdefined) and an
+ * instruction is only evaluated once its block has been reached, so a phi
+ * ignores operands from edges that are never taken and a branch on a
+ * constant only opens one edge. This finds in one pass what fixpoint(cp,cf)
+ * finds, plus constants that depend on a branch never being taken.
+ *
+ * Loads from allocas that are only loaded and stored take the meet of the
+ * stores reaching them (from the reaching-stores analysis), ignoring stores
+ * in blocks that are never reached.
+ *
+ * Afterwards constant values are replaced, branches with one taken edge
+ * become unconditional and blocks never reached are deleted.
+ */
+
+#include <utility>
+#include <vector>
+
+#include <llvm-c/Core.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Instructions.h>
+
+#include "analysisManager.h"
+#include "constantEvaluation.h"
+#include "controlFlowEdits.h"
+#include "passManager.h"
+
+using namespace llvm;
+
+/* Lattice value: unknown (no evidence yet), one constant, or overdefined. */
+struct LatticeValue {
+  enum State { Unknown, Constant, Overdefined };
+  State state = Unknown;
+  ConstantInt* constant = nullptr;
+
+  static LatticeValue of(ConstantInt* c) { return {Constant, c}; }
+  static LatticeValue overdefined() { return {Overdefined, nullptr}; }
+
+  bool operator==(const LatticeValue& o) const { return state == o.state && constant == o.constant; }
+  bool operator!=(const LatticeValue& o) const { return !(*this == o); }
+};
+
+static LatticeValue meet(const LatticeValue& a, const LatticeValue& b) {
+  if (a.state == LatticeValue::Unknown) return b;
+  if (b.state == LatticeValue::Unknown) return a;
+  if (a == b) return a;
+  return LatticeValue::overdefined();
+}
+
+/*
+ * Solver state for one function. Blocks are numbered as in the cached CFG.
+ */
+struct SCCPSolver {
+  const BlockGraph& g;
+  DenseMap<Value*, LatticeValue> values;
+  std::vector<bool> executable;
+  DenseSet<std::pair<unsigned, unsigned>> edges;  // taken edges, from -> to
+
+  // Stores reaching each local-slot load, and the loads each store reaches
+  DenseMap<LoadInst*, SmallVector<StoreInst*, 2>> reachingStores;
+  DenseMap<StoreInst*, SmallVector<LoadInst*, 2>> readers;
+
+  SmallVector<unsigned, 16> blockWork;
+  SmallVector<Value*, 64> valueWork;
+
+  explicit SCCPSolver(const BlockGraph& graph) : g(graph), executable(graph.blocks.size(), false) {}
+
+  unsigned blockOf(Instruction* I) const { return g.number.at(wrap(I->getParent())); }
+
+  LatticeValue get(Value* v) {
+    if (ConstantInt* c = dyn_cast<ConstantInt>(v)) return LatticeValue::of(c);
+    if (!isa<Instruction>(v) || !v->getType()->isIntegerTy()) return LatticeValue::overdefined();
+    return values[v];
+  }
+
+  /* Lowers `v` to meet(old, `value`); queues its users if that changed it. */
+  void update(Value* v, const LatticeValue& value) {
+    LatticeValue& old = values[v];
+    LatticeValue lowered = meet(old, value);
+    if (lowered == old) return;
+    old = lowered;
+    valueWork.push_back(v);
+  }
+
+  void markEdge(unsigned from, unsigned to) {
+    if (!edges.insert({from, to}).second) return;
+
+    if (!executable[to]) {
+      executable[to] = true;
+      blockWork.push_back(to);
+      return;
+    }
+
+    // A new way into a reached block: only its phis can change
+    for (PHINode& phi : unwrap(g.blocks[to])->phis()) visit(&phi);
+  }
+
+  void visitTerminator(Instruction* I, unsigned b) {
+    if (BranchInst* br = dyn_cast<BranchInst>(I)) {
+      if (br->isUnconditional()) {
+        markEdge(b, g.number.at(wrap(br->getSuccessor(0))));
+        return;
+      }
+
+      LatticeValue cond = get(br->getCondition());
+      if (cond.state == LatticeValue::Unknown) return;
+      for (unsigned i = 0; i < 2; i++) {
+        // Successor 0 is taken when the condition is true
+        if (cond.state == LatticeValue::Constant && cond.constant->isZero() != (i == 1)) continue;
+        markEdge(b, g.number.at(wrap(br->getSuccessor(i))));
+      }
+      return;
+    }
+
+    // Other terminators (the builder emits none with successors) take every edge
+    for (unsigned i = 0; i < I->getNumSuccessors(); i++) {
+      markEdge(b, g.number.at(wrap(I->getSuccessor(i))));
+    }
+  }
+
+  LatticeValue evaluate(Instruction* I, unsigned b) {
+    if (PHINode* phi = dyn_cast<PHINode>(I)) {
+      LatticeValue result;
+      for (unsigned i = 0; i < phi->getNumIncomingValues(); i++) {
+        unsigned pred = g.number.at(wrap(phi->getIncomingBlock(i)));
+        if (!edges.count({pred, b})) continue;
+        result = meet(result, get(phi->getIncomingValue(i)));
+        if (result.state == LatticeValue::Overdefined) break;
+      }
+      return result;
+    }
+
+    if (LoadInst* load = dyn_cast<LoadInst>(I)) {
+      auto it = reachingStores.find(load);
+      if (it == reachingStores.end()) return LatticeValue::overdefined();
+
+      // Stores in blocks never reached cannot reach the load
+      LatticeValue result;
+      for (StoreInst* store : it->second) {
+        if (!executable[blockOf(store)]) continue;
+        result = meet(result, get(store->getValueOperand()));
+      }
+      return result;
+    }
+
+    if (SelectInst* select = dyn_cast<SelectInst>(I)) {
+      LatticeValue cond = get(select->getCondition());
+      if (cond.state == LatticeValue::Unknown) return cond;
+      if (cond.state == LatticeValue::Constant) {
+        return get(cond.constant->isZero() ? select->getFalseValue() : select->getTrueValue());
+      }
+      return meet(get(select->getTrueValue()), get(select->getFalseValue()));
+    }
+
+    if (!isEvaluable(*I)) return LatticeValue::overdefined();
+
+    // Everything else here is a function of constant operands
+    ConstantInt* operands[2];
+    for (unsigned i = 0; i < I->getNumOperands(); i++) {
+      LatticeValue v = get(I->getOperand(i));
+      if (v.state != LatticeValue::Constant) return v;
+      operands[i] = v.constant;
+    }
+
+    ConstantInt* result = evaluateConstant(*I, operands);
+    return result ? LatticeValue::of(result) : LatticeValue::overdefined();
+  }
+
+  void visit(Instruction* I) {
+    unsigned b = blockOf(I);
+    if (!executable[b]) return;
+
+    if (I->isTerminator()) {
+      visitTerminator(I, b);
+      return;
+    }
+
+    // A store changes what the loads it reaches see
+    if (StoreInst* store = dyn_cast<StoreInst>(I)) {
+      auto it = readers.find(store);
+      if (it == readers.end()) return;
+      for (LoadInst* load : it->second) visit(load);
+      return;
+    }
+
+    if (I->getType()->isVoidTy()) return;
+    if (!I->getType()->isIntegerTy()) {
+      update(I, LatticeValue::overdefined());
+      return;
+    }
+    update(I, evaluate(I, b));
+  }
+
+  void solve() {
+    while (!blockWork.empty() || !valueWork.empty()) {
+      if (!valueWork.empty()) {
+        Value* v = valueWork.pop_back_val();
+        for (User* user : v->users()) {
+          if (Instruction* userInst = dyn_cast<Instruction>(user)) visit(userInst);
+        }
+        continue;
+      }
+
+      unsigned b = blockWork.pop_back_val();
+      for (Instruction& I : *unwrap(g.blocks[b])) visit(&I);
+    }
+  }
+
+  /*
+   * A branch on a value still unknown after solving (e.g. a load whose only
+   * reaching stores were never reached) would leave its block without a
+   * successor. Forces such conditions to overdefined and solves again.
+   */
+  bool resolveUnknownBranches() {
+    bool forced = false;
+    for (unsigned b = 0; b < g.blocks.size(); b++) {
+      if (!executable[b]) continue;
+
+      Instruction* term = unwrap(g.blocks[b])->getTerminator();
+      BranchInst* br = dyn_cast<BranchInst>(term);
+      if (!br || br->isUnconditional()) continue;
+      Value* cond = br->getCondition();
+      if (get(cond).state != LatticeValue::Unknown) continue;
+
+      values[cond] = LatticeValue::overdefined();
+      valueWork.push_back(cond);
+      visitTerminator(term, b);
+      forced = true;
+    }
+    return forced;
+  }
+};
+
+/* Records the stores reaching each load of a local slot. */
+static void findReachingStores(FunctionAnalyses& analyses, SCCPSolver& solver) {
+  const BlockGraph& g = analyses.cfg();
+  DenseMap<Value*, bool> localSlot;
+  bool anyLocal = false;
+
+  for (LLVMBasicBlockRef block : g.blocks) {
+    for (Instruction& I : *unwrap(block)) {
+      LoadInst* load = dyn_cast<LoadInst>(&I);
+      if (!load || !load->isSimple() || !load->getType()->isIntegerTy()) continue;
+
+      auto slot = localSlot.insert({load->getPointerOperand(), false});
+      if (slot.second) slot.first->second = isLocalSlot(wrap(load->getPointerOperand()));
+      anyLocal |= slot.first->second;
+    }
+  }
+
+  // After mem2reg there is usually nothing to track, so skip the dataflow
+  if (!anyLocal) return;
+
+  const StoreIndex& numbering = analyses.stores();
+  const std::vector<FactSet>& in = analyses.reachingStoresIn();
+
+  for (unsigned b = 0; b < g.blocks.size(); b++) {
+    FactSet R = in[b];
+
+    for (Instruction& I : *unwrap(g.blocks[b])) {
+      LoadInst* load = dyn_cast<LoadInst>(&I);
+      if (!load) {
+        numbering.step(wrap(&I), R);
+        continue;
+      }
+      if (!load->isSimple() || !load->getType()->isIntegerTy()) continue;
+
+      Value* pointer = load->getPointerOperand();
+      if (!localSlot[pointer]) continue;
+
+      // As in cp, a load needs at least one reaching store
+      auto address = numbering.addresses.find(wrap(pointer));
+      if (address == numbering.addresses.end()) continue;
+
+      SmallVector<StoreInst*, 2> reaching;
+      for (unsigned s : numbering.storesTo[address->second]) {
+        if (!R.test(s)) continue;
+        StoreInst* store = unwrap<StoreInst>(numbering.stores[s]);
+        if (store->getValueOperand()->getType() != load->getType()) {
+          reaching.clear();
+          break;
+        }
+        reaching.push_back(store);
+      }
+      if (reaching.empty()) continue;
+
+      for (StoreInst* store : reaching) solver.readers[store].push_back(load);
+      solver.reachingStores[load] = std::move(reaching);
+    }
+  }
+}
+
+/*
+ * Sparse Conditional Constant Propagation
+ * Solves constants and reached edges together; see the top of this file.
+ */
+bool sparseConditionalPropagation(LLVMValueRef function) {
+  FunctionAnalyses& analyses = analysesFor(function);
+  const BlockGraph& g = analyses.cfg();
+  if (g.numReachable == 0) return false;
+
+  SCCPSolver solver(g);
+  findReachingStores(analyses, solver);
+
+  solver.executable[g.order[0]] = true;
+  solver.blockWork.push_back(g.order[0]);
+  do {
+    solver.solve();
+  } while (solver.resolveUnknownBranches());
+
+  bool changed = false;
+
+  // Replace constant values in reached blocks
+  for (unsigned b = 0; b < g.blocks.size(); b++) {
+    if (!solver.executable[b]) continue;
+
+    BasicBlock* bb = unwrap(g.blocks[b]);
+    for (auto it = bb->begin(); it != bb->end();) {
+      Instruction* I = &*it++;
+      if (!I->getType()->isIntegerTy()) continue;
+
+      auto value = solver.values.find(I);
+      if (value == solver.values.end() || value->second.state != LatticeValue::Constant) continue;
+
+      I->replaceAllUsesWith(value->second.constant);
+      if (isa<LoadInst>(I)) passCounters.loadsReplaced++;
+      else passCounters.instructionsFolded++;
+      I->eraseFromParent();
+      passCounters.instructionsDeleted++;
+      changed = true;
+    }
+  }
+
+  // Branches on constants now keep one edge; then drop the blocks never reached
+  std::vector<BasicBlock*> dead;
+  for (unsigned b = 0; b < g.blocks.size(); b++) {
+    BasicBlock* bb = unwrap(g.blocks[b]);
+    if (!solver.executable[b]) {
+      dead.push_back(bb);
+      continue;
+    }
+
+    BranchInst* br = dyn_cast<BranchInst>(bb->getTerminator());
+    if (br && foldConstantBranch(br)) changed = true;
+  }
+
+  if (!dead.empty()) {
+    deleteBlocks(dead);
+    changed = true;
+  }
+
+  return changed;
+}
@@ -0,0 +1,297 @@
+/*
+ * ssaPromotion.cpp
+ *
+ * Promotes stack slots to SSA registers ("mem2reg" in pipelines). The IR
+ * builder gives every variable an alloca and reads it back with loads. For
+ * integer allocas that are only loaded and stored (their address never
+ * escapes) this:
+ *  1) places phis at the iterated dominance frontier of the blocks that
+ *     store to the alloca, skipping blocks where it is not live
+ *  2) walks the dominator tree replacing each load with the value reaching
+ *     it and filling in phi operands on the way
+ *  3) deletes the loads, stores and the alloca, and folds phis that merge
+ *     only one value
+ */
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <llvm-c/Core.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Instructions.h>
+
+#include "analysisManager.h"
+#include "passManager.h"
+
+using namespace llvm;
+
+/*
+ * Returns true if `alloca` holds one integer that is only loaded and stored
+ * directly, so no other instruction can see its address.
+ */
+static bool isPromotable(AllocaInst* alloca) {
+  if (!alloca->getAllocatedType()->isIntegerTy() || alloca->isArrayAllocation()) return false;
+
+  for (User* user : alloca->users()) {
+    if (LoadInst* load = dyn_cast<LoadInst>(user)) {
+      if (load->isVolatile() || load->getType() != alloca->getAllocatedType()) return false;
+      continue;
+    }
+
+    StoreInst* store = dyn_cast<StoreInst>(user);
+    if (!store || store->isVolatile() || store->getValueOperand() == alloca) return false;
+    if (store->getValueOperand()->getType() != alloca->getAllocatedType()) return false;
+  }
+  return true;
+}
+
+/* Promoted alloca for a load or store address, with its slot number. */
+static AllocaInst* promotedAddress(Value* pointer, const DenseMap<AllocaInst*, unsigned>& slot,
+                                   unsigned& s) {
+  AllocaInst* alloca = dyn_cast<AllocaInst>(pointer);
+  if (!alloca) return nullptr;
+
+  auto it = slot.find(alloca);
+  if (it == slot.end()) return nullptr;
+  s = it->second;
+  return alloca;
+}
+
+/*
+ * Places the phis for `alloca` (slot `s`): pruned SSA, so only blocks in the
+ * iterated dominance frontier of its stores where the value is live get one.
+ */
+static void placePhis(AllocaInst* alloca, unsigned s, const BlockGraph& g,
+                      const std::vector<std::vector<unsigned>>& frontiers,
+                      std::vector<SmallVector<std::pair<unsigned, PHINode*>, 4>>& phis) {
+  size_t n = g.blocks.size();
+
+  // First access per block decides whether the value is live on entry
+  DenseMap<BasicBlock*, Instruction*> first;
+  std::vector<bool> defines(n, false);
+  for (User* user : alloca->users()) {
+    Instruction* I = cast<Instruction>(user);
+    BasicBlock* bb = I->getParent();
+
+    if (isa<StoreInst>(I)) defines[g.number.at(wrap(bb))] = true;
+    auto inserted = first.insert({bb, I});
+    if (!inserted.second && I->comesBefore(inserted.first->second)) inserted.first->second = I;
+  }
+
+  // Live-in blocks: read before written, then backwards through blocks
+  // that do not write
+  std::vector<bool> liveIn(n, false);
+  std::vector<unsigned> worklist;
+  for (const auto& entry : first) {
+    unsigned b = g.number.at(wrap(entry.first));
+    if (isa<LoadInst>(entry.second) && g.reachable(b)) {
+      liveIn[b] = true;
+      worklist.push_back(b);
+    }
+  }
+  while (!worklist.empty()) {
+    unsigned b = worklist.back();
+    worklist.pop_back();
+    for (unsigned pred : g.preds[b]) {
+      if (!g.reachable(pred) || defines[pred] || liveIn[pred]) continue;
+      liveIn[pred] = true;
+      worklist.push_back(pred);
+    }
+  }
+
+  // Iterated dominance frontier of the defining blocks; a phi is a
+  // definition too
+  std::vector<bool> queued(n, false), hasPhi(n, false);
+  for (unsigned b = 0; b < n; b++) {
+    if (defines[b] && g.reachable(b)) {
+      queued[b] = true;
+      worklist.push_back(b);
+    }
+  }
+
+  unsigned version = 0;
+  while (!worklist.empty()) {
+    unsigned b = worklist.back();
+    worklist.pop_back();
+
+    for (unsigned d : frontiers[b]) {
+      if (hasPhi[d] || !liveIn[d]) continue;
+      hasPhi[d] = true;
+
+      BasicBlock* bb = unwrap(g.blocks[d]);
+      PHINode* phi = PHINode::Create(alloca->getAllocatedType(), g.preds[d].size(),
+                                     alloca->getName() + "." + Twine(version++),
+                                     bb->getFirstNonPHI());
+      phis[d].push_back({s, phi});
+
+      if (!queued[d]) {
+        queued[d] = true;
+        worklist.push_back(d);
+      }
+    }
+  }
+}
+
+/*
+ * Returns the single value `phi` merges, ignoring itself and undef, or
+ * nullptr. With undef operands the value must also dominate the phi.
+ */
+static Value* trivialValue(PHINode* phi, const BlockGraph& g, const BlockDominators& dt) {
+  Value* common = nullptr;
+  bool sawUndef = false;
+  for (Value* v : phi->incoming_values()) {
+    if (v == phi) continue;
+    if (isa<UndefValue>(v)) {
+      sawUndef = true;
+      continue;
+    }
+    if (common && v != common) return nullptr;
+    common = v;
+  }
+  if (!common) return UndefValue::get(phi->getType());
+
+  Instruction* def = dyn_cast<Instruction>(common);
+  if (sawUndef && def) {
+    unsigned from = g.number.at(wrap(def->getParent()));
+    unsigned to = g.number.at(wrap(phi->getParent()));
+    if (from == to || !dt.dominates(from, to)) return nullptr;
+  }
+  return common;
+}
+
+/*
+ * Promote allocas to SSA registers
+ * Promotes every non-escaping integer alloca; see the top of this file.
+ */
+bool promoteAllocas(LLVMValueRef function) {
+  FunctionAnalyses& analyses = analysesFor(function);
+  const BlockGraph& g = analyses.cfg();
+  size_t n = g.blocks.size();
+
+  std::vector<AllocaInst*> allocas;
+  DenseMap<AllocaInst*, unsigned> slot;
+  for (unsigned b = 0; b < n; b++) {
+    for (Instruction& I : *unwrap(g.blocks[b])) {
+      AllocaInst* alloca = dyn_cast<AllocaInst>(&I);
+      if (!alloca || !isPromotable(alloca)) continue;
+      slot[alloca] = allocas.size();
+      allocas.push_back(alloca);
+    }
+  }
+  if (allocas.empty()) return false;
+
+  const BlockDominators& dt = analyses.dominators();
+  const std::vector<std::vector<unsigned>>& frontiers = analyses.dominanceFrontiers();
+
+  std::vector<SmallVector<std::pair<unsigned, PHINode*>, 4>> phis(n);
+  for (unsigned s = 0; s < allocas.size(); s++) placePhis(allocas[s], s, g, frontiers, phis);
+
+  // Rename along the dominator tree; each frame carries the value of every
+  // slot on entry to its block. Reading a slot before any store gives undef.
+  struct Frame {
+    unsigned block;
+    std::vector<Value*> values;
+  };
+  std::vector<Frame> stack(1);
+  stack[0].block = g.order[0];
+  for (AllocaInst* alloca : allocas) stack[0].values.push_back(UndefValue::get(alloca->getAllocatedType()));
+
+  unsigned long long deleted = 0;
+  while (!stack.empty()) {
+    Frame frame = std::move(stack.back());
+    stack.pop_back();
+    BasicBlock* bb = unwrap(g.blocks[frame.block]);
+
+    for (const auto& entry : phis[frame.block]) frame.values[entry.first] = entry.second;
+
+    for (auto it = bb->begin(); it != bb->end();) {
+      Instruction* I = &*it++;
+      unsigned s;
+
+      if (LoadInst* load = dyn_cast<LoadInst>(I)) {
+        if (!promotedAddress(load->getPointerOperand(), slot, s)) continue;
+        load->replaceAllUsesWith(frame.values[s]);
+        load->eraseFromParent();
+        deleted++;
+      } else if (StoreInst* store = dyn_cast<StoreInst>(I)) {
+        if (!promotedAddress(store->getPointerOperand(), slot, s)) continue;
+        frame.values[s] = store->getValueOperand();
+        store->eraseFromParent();
+        deleted++;
+      }
+    }
+
+    // One phi operand per edge, so duplicate edges get one each
+    for (unsigned succ : g.succs[frame.block]) {
+      for (const auto& entry : phis[succ]) entry.second->addIncoming(frame.values[entry.first], bb);
+    }
+
+    const std::vector<unsigned>& children = dt.children[frame.block];
+    for (size_t c = children.size(); c-- > 0;) {
+      if (c == 0) stack.push_back({children[c], std::move(frame.values)});
+      else stack.push_back({children[c], frame.values});
+    }
+  }
+
+  // Unreachable blocks: their reads see undef and their edges feed undef
+  for (unsigned p = g.numReachable; p < n; p++) {
+    unsigned b = g.order[p];
+    BasicBlock* bb = unwrap(g.blocks[b]);
+
+    for (auto it = bb->begin(); it != bb->end();) {
+      Instruction* I = &*it++;
+      unsigned s;
+
+      if (LoadInst* load = dyn_cast<LoadInst>(I)) {
+        if (!promotedAddress(load->getPointerOperand(), slot, s)) continue;
+        load->replaceAllUsesWith(UndefValue::get(load->getType()));
+        load->eraseFromParent();
+        deleted++;
+      } else if (StoreInst* store = dyn_cast<StoreInst>(I)) {
+        if (!promotedAddress(store->getPointerOperand(), slot, s)) continue;
+        store->eraseFromParent();
+        deleted++;
+      }
+    }
+
+    for (unsigned succ : g.succs[b]) {
+      for (const auto& entry : phis[succ]) {
+        entry.second->addIncoming(UndefValue::get(entry.second->getType()), bb);
+      }
+    }
+  }
+
+  for (AllocaInst* alloca : allocas) alloca->eraseFromParent();
+  deleted += allocas.size();
+
+  // Fold phis that merge one value; folding one can make another trivial
+  std::vector<PHINode*> placed;
+  for (const auto& blockPhis : phis) {
+    for (const auto& entry : blockPhis) placed.push_back(entry.second);
+  }
+
+  bool folded = true;
+  while (folded) {
+    folded = false;
+    for (PHINode*& phi : placed) {
+      if (!phi) continue;
+      Value* v = trivialValue(phi, g, dt);
+      if (!v) continue;
+
+      phi->replaceAllUsesWith(v);
+      phi->eraseFromParent();
+      phi = nullptr;
+      deleted++;
+      folded = true;
+    }
+  }
+
+  passCounters.allocasPromoted += allocas.size();
+  passCounters.instructionsDeleted += deleted;
+  return true;
+}
@@ -0,0 +1,188 @@
+/*
+ * worklistOptimizations.cpp
+ *
+ * Constant propagation, constant folding and dead code elimination driven by
+ * worklists. Produces the same result as fixpoint(cp,cf,dce) apart from
+ * branches on constants, which it leaves to cf and sccp. After the first
+ * visit an instruction is only looked at again when something it depends
+ * on changed:
+ *  - users of a replaced load or folded instruction are queued for folding
+ *  - loads reached by a store whose value became constant are queued again
+ *  - operands of a deleted instruction are queued for DCE
+ */
+
+#include <llvm-c/Core.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Instructions.h>
+
+#include "analysisManager.h"
+#include "constantEvaluation.h"
+#include "passManager.h"
+
+using namespace llvm;
+
+static bool isFoldable(const Instruction* I) {
+  return isEvaluable(*I) || isa<SelectInst>(I);
+}
+
+/*
+ * Worklists and bookkeeping for one run over a function.
+ */
+struct Worklists {
+  SmallVector<LoadInst*, 32> loads;
+  SmallVector<Instruction*, 32> folds;
+  SmallVector<Instruction*, 64> dead;
+
+  // Reaching stores to the loaded address, per load, and the reverse map
+  DenseMap<LoadInst*, SmallVector<StoreInst*, 2>> reachingStores;
+  DenseMap<StoreInst*, SmallVector<LoadInst*, 2>> readers;
+
+  // Erased instructions; worklists may still name them
+  DenseSet<Instruction*> erased;
+
+  /* Queues every user of `I` that may change once `I` is replaced. */
+  void queueUsers(Instruction* I) {
+    for (User* user : I->users()) {
+      Instruction* userInst = cast<Instruction>(user);
+      if (isFoldable(userInst)) folds.push_back(userInst);
+
+      // A store of this value may now be a constant store
+      if (StoreInst* store = dyn_cast<StoreInst>(userInst)) {
+        auto it = readers.find(store);
+        if (it != readers.end()) loads.append(it->second.begin(), it->second.end());
+      }
+    }
+  }
+
+  /* Replaces `I` by `v`, queues affected users and erases it. */
+  void replace(Instruction* I, Value* v) {
+    queueUsers(I);
+    I->replaceAllUsesWith(v);
+    erase(I);
+  }
+
+  /* Erases `I` and queues its instruction operands for DCE. */
+  void erase(Instruction* I) {
+    for (Value* op : I->operands()) {
+      if (Instruction* opInst = dyn_cast<Instruction>(op)) dead.push_back(opInst);
+    }
+
+    I->eraseFromParent();
+    erased.insert(I);
+    passCounters.instructionsDeleted++;
+  }
+};
+
+/*
+ * Replaces load `I` if all stores reaching it write the same constant.
+ */
+static bool propagateLoad(Worklists& w, LoadInst* I) {
+  auto it = w.reachingStores.find(I);
+  if (it == w.reachingStores.end() || it->second.empty()) return false;
+  const SmallVector<StoreInst*, 2>& stores = it->second;
+
+  long long val = 0;
+  for (size_t idx = 0; idx < stores.size(); idx++) {
+    ConstantInt* c = dyn_cast<ConstantInt>(stores[idx]->getValueOperand());
+    if (!c) return false;
+
+    long long sVal = c->getSExtValue();
+    if (idx == 0) val = sVal;
+    else if (sVal != val) return false;
+  }
+
+  w.replace(I, ConstantInt::get(I->getType(), (unsigned long long)val, true));
+  passCounters.loadsReplaced++;
+  return true;
+}
+
+/*
+ * Folds `I` when its operands are constants (as cf does), or picks the
+ * operand of a select on a constant condition.
+ */
+static bool foldInstruction(Worklists& w, Instruction* I) {
+  Value* folded = foldConstantOperands(*I);
+
+  if (SelectInst* select = dyn_cast<SelectInst>(I)) {
+    ConstantInt* cond = dyn_cast<ConstantInt>(select->getCondition());
+    if (cond) folded = cond->isZero() ? select->getFalseValue() : select->getTrueValue();
+    if (folded == I) return false;
+  }
+  if (!folded) return false;
+
+  w.replace(I, folded);
+  passCounters.instructionsFolded++;
+  return true;
+}
+
+/*
+ * Worklist constant propagation, folding and DCE ("prop" in pipelines).
+ */
+bool propagateConstants(LLVMValueRef function) {
+  bool changed = false;
+  Worklists w;
+
+  FunctionAnalyses& analyses = analysesFor(function);
+  const BlockGraph& g = analyses.cfg();
+  const StoreIndex& numbering = analyses.stores();
+  const std::vector<FactSet>& in = analyses.reachingStoresIn();
+
+  // Seed: record the stores reaching each load, queue every instruction once
+  for (unsigned b = 0; b < g.blocks.size(); b++) {
+    FactSet R = in[b];
+
+    for (Instruction& I : *unwrap(g.blocks[b])) {
+
+      w.dead.push_back(&I);
+      if (isFoldable(&I)) w.folds.push_back(&I);
+
+      LoadInst* load = dyn_cast<LoadInst>(&I);
+      if (!load) {
+        numbering.step(wrap(&I), R);
+        continue;
+      }
+
+      // A clobbered address may hold a value none of the stores wrote
+      auto address = numbering.addresses.find(wrap(load->getPointerOperand()));
+      if (address == numbering.addresses.end() || numbering.clobbered(address->second, R)) continue;
+
+      SmallVector<StoreInst*, 2>& reaching = w.reachingStores[load];
+      for (unsigned s : numbering.storesTo[address->second]) {
+        if (!R.test(s)) continue;
+        StoreInst* store = unwrap<StoreInst>(numbering.stores[s]);
+        reaching.push_back(store);
+        w.readers[store].push_back(load);
+      }
+      if (!reaching.empty()) w.loads.push_back(load);
+    }
+  }
+
+  // DCE waits until propagation and folding have settled, so it only sees
+  // instructions that lost their last use
+  while (!w.loads.empty() || !w.folds.empty() || !w.dead.empty()) {
+    if (!w.loads.empty()) {
+      LoadInst* I = w.loads.pop_back_val();
+      if (!w.erased.count(I)) changed |= propagateLoad(w, I);
+      continue;
+    }
+
+    if (!w.folds.empty()) {
+      Instruction* I = w.folds.pop_back_val();
+      if (!w.erased.count(I)) changed |= foldInstruction(w, I);
+      continue;
+    }
+
+    Instruction* I = w.dead.pop_back_val();
+    if (w.erased.count(I)) continue;
+    if (!I->use_empty() || isSideEffect(wrap(I))) continue;
+
+    w.erase(I);
+    changed = true;
+  }
+
+  return changed;
+}
@@ -8,8 +8,13 @@
     extern int yyparse(void);
     int yyerror(const char *);
     extern FILE *yyin;
+
+    /* tag the node built by a rule with the position of one of its symbols */
+    #define AT(node, loc) setLoc((node), (loc).first_line, (loc).first_column)
 %}
 
+%locations
+
 %union {int ival;
         char *sval;
         astNode *node;
@@ -37,40 +42,40 @@
 program : extern extern func  { root = createProg($1, $2, $3);   $$ = root; } ;
 
 extern
-    : EXTERN VOID PRINT '(' INT ')' ';'   { $$ = createExtern("print"); }
-    | EXTERN INT  READ  '(' ')' ';'       { $$ = createExtern("read"); }
+    : EXTERN VOID PRINT '(' INT ')' ';'   { $$ = AT(createExtern("print"), @1); }
+    | EXTERN INT  READ  '(' ')' ';'       { $$ = AT(createExtern("read"), @1); }
     ;
 
-func   : INT ID '(' ')' block                { $$ = createFunc($2, NULL, $5); }
-       | INT ID '(' INT ID ')' block         { $$ = createFunc($2, createVar($5), $7); }
+func   : INT ID '(' ')' block                { $$ = AT(createFunc($2, NULL, $5), @2); }
+       | INT ID '(' INT ID ')' block         { $$ = AT(createFunc($2, AT(createVar($5), @5), $7), @2); }
        ;
 
 
-assignment : ID '=' expr  { $$ = createAsgn(createVar($1), $3); } ;
+assignment : ID '=' expr  { $$ = AT(createAsgn(AT(createVar($1), @1), $3), @1); } ;
 
-declaration: INT ID ';'   { $$ = createDecl($2); } ;
+declaration: INT ID ';'   { $$ = AT(createDecl($2), @2); } ;
 
-return_statement : RETURN expr ';'  { $$ = createRet($2); } ;
+return_statement : RETURN expr ';'  { $$ = AT(createRet($2), @1); } ;
 
-print_statement: PRINT '(' expr ')' ';'  { $$ = createCall("print", $3); } ;
+print_statement: PRINT '(' expr ')' ';'  { $$ = AT(createCall("print", $3), @1); } ;
 
-condition : expr '<'  expr  { $$ = createRExpr($1, $3, lt); }
-          | expr '>'  expr  { $$ = createRExpr($1, $3, gt); }
-          | expr LE   expr  { $$ = createRExpr($1, $3, le); }
-          | expr GE   expr  { $$ = createRExpr($1, $3, ge); }
-          | expr EQ   expr  { $$ = createRExpr($1, $3, eq); }
-          | expr NE   expr  { $$ = createRExpr($1, $3, neq); }
+condition : expr '<'  expr  { $$ = AT(createRExpr($1, $3, lt), @2); }
+          | expr '>'  expr  { $$ = AT(createRExpr($1, $3, gt), @2); }
+          | expr LE   expr  { $$ = AT(createRExpr($1, $3, le), @2); }
+          | expr GE   expr  { $$ = AT(createRExpr($1, $3, ge), @2); }
+          | expr EQ   expr  { $$ = AT(createRExpr($1, $3, eq), @2); }
+          | expr NE   expr  { $$ = AT(createRExpr($1, $3, neq), @2); }
           ;
 
-block: '{' statement_list '}' { $$ = createBlock($2); } ;
+block: '{' statement_list '}' { $$ = AT(createBlock($2), @1); } ;
 
 statement_list: statement_list statement    {   $1->push_back($2); $$ = $1; }
               | statement                   {   $$ = new vector<astNode*>(); $$->push_back($1);}
               ;
 
-statement  : WHILE '(' condition ')' statement              { $$ = createWhile($3, $5); }
-           | IF '(' condition ')' statement %prec IFX       { $$ = createIf($3, $5, NULL); }
-           | IF '(' condition ')' statement ELSE statement  { $$ = createIf($3, $5, $7); }
+statement  : WHILE '(' condition ')' statement              { $$ = AT(createWhile($3, $5), @1); }
+           | IF '(' condition ')' statement %prec IFX       { $$ = AT(createIf($3, $5, NULL), @1); }
+           | IF '(' condition ')' statement ELSE statement  { $$ = AT(createIf($3, $5, $7), @1); }
            | declaration        { $$ = $1; }
            | return_statement   { $$ = $1; }
            | print_statement    { $$ = $1; }
@@ -80,18 +85,18 @@ statement  : WHILE '(' condition ')' statement              { $$ = createWhile($
            ;
 
 expr : term                   { $$ = $1; }
-     | term '+' term          { $$ = createBExpr($1, $3, add); }
-     | term '-' term          { $$ = createBExpr($1, $3, sub); }
+     | term '+' term          { $$ = AT(createBExpr($1, $3, add), @2); }
+     | term '-' term          { $$ = AT(createBExpr($1, $3, sub), @2); }
      ;
 
 term : factor                { $$ = $1; }
-     | factor '*' factor     { $$ = createBExpr($1, $3, mul); }
-     | factor '/' factor     { $$ = createBExpr($1, $3, divide); }
+     | factor '*' factor     { $$ = AT(createBExpr($1, $3, mul), @2); }
+     | factor '/' factor     { $$ = AT(createBExpr($1, $3, divide), @2); }
      ;
 
-factor : ID                     {   $$ = createVar($1);  }
-         | NUM                  {   $$ = createCnst($1); }
-         | READ '(' ')'         {   $$ = createCall("read", NULL); }
+factor : ID                     {   $$ = AT(createVar($1), @1);  }
+         | NUM                  {   $$ = AT(createCnst($1), @1); }
+         | READ '(' ')'         {   $$ = AT(createCall("read", NULL), @1); }
          | '(' expr ')'         {   $$ = $2; }
          ;
 